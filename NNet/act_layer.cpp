@@ -2,65 +2,160 @@
 #include "act_layer.h"
 
 namespace NNet {
-	ActL::ActL(double lrate_, vd_F_vd ActFunc_, md_F_vd ActDeriv_) {
+	template <typename T> BasicActL<T>::BasicActL(T lrate_, v_F_v<T> ActFunc_, m_F_v<T> ActDeriv_) {
 		id = "Act";
 		lrate = lrate_;
 		ActFunc = ActFunc_;
 		ActDeriv = ActDeriv_;
+		ActElemDeriv = nullptr;
 	}
-	ActL::ActL(const ActL& other) {
+	template <typename T> BasicActL<T>::BasicActL(T lrate_, v_F_v<T> ActFunc_, m_F_m<T> ActElemDeriv_) {
+		id = "Act";
+		lrate = lrate_;
+		ActFunc = ActFunc_;
+		ActDeriv = nullptr;
+		ActElemDeriv = ActElemDeriv_;
+	}
+	template <typename T> BasicActL<T>::BasicActL(const BasicActL& other) {
 		id = "Act";
 		lrate = other.LRate();
 		bias = other.Bias();
 		ActFunc = other.GetActFunc();
 		ActDeriv = other.GetActDeriv();
+		ActElemDeriv = other.GetActElemDeriv();
 		in_sz = other.InSize();
 		out_sz = other.OutSize();
 	}
-	ActL::ActL(std::istream& istr) {
+	template <typename T> BasicActL<T>::BasicActL(std::istream& istr) {
 		id = "Act";
 		Read(istr);
 	}
+	template <typename T> BasicActL<T>::BasicActL(BinaryReader& reader) {
+		id = "Act";
+		ReadBinary(reader);
+	}
 
-	vd_F_vd ActL::GetActFunc() const { return ActFunc; }
-	md_F_vd ActL::GetActDeriv() const { return ActDeriv; }
+	template <typename T> v_F_v<T> BasicActL<T>::GetActFunc() const { return ActFunc; }
+	template <typename T> m_F_v<T> BasicActL<T>::GetActDeriv() const { return ActDeriv; }
+	template <typename T> m_F_m<T> BasicActL<T>::GetActElemDeriv() const { return ActElemDeriv; }
 
-	Eigen::VectorXd ActL::Bias() const { return bias; }
+	template <typename T> Eigen::VectorX<T> BasicActL<T>::Bias() const { return bias; }
 
-	int ActL::InSize() const { return in_sz; }
-	int ActL::OutSize() const { return out_sz; }
+	template <typename T> int BasicActL<T>::InSize() const { return in_sz; }
+	template <typename T> int BasicActL<T>::OutSize() const { return out_sz; }
 
-	void ActL::SetInputSize(int input_sz) {
+	template <typename T> void BasicActL<T>::SetInputSize(int input_sz) {
 		in_sz = input_sz;
 		out_sz = in_sz;
 	}
-	void ActL::InitParams(d_F GenFunc) {
-		bias = Eigen::VectorXd::Zero(in_sz);
+	template <typename T> void BasicActL<T>::InitParams(d_F GenFunc) {
+		bias = Eigen::VectorX<T>::Zero(in_sz);
 	}
 
-	Eigen::VectorXd ActL::Forward(const Eigen::VectorXd& in) {
-		if (in.size() != in_sz) throw Exception("ActL::Forward: Input sizes don't match!");
-		cache = in;
-		return ActFunc(in + bias);
+	template <typename T> Eigen::MatrixX<T> BasicActL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_sz) throw Exception("ActL::ForwardBatch: Input sizes don't match!");
+		cache = in.colwise() + bias;
+
+		Eigen::MatrixX<T> ret(out_sz, in.cols());
+		for (int i = 0; i < in.cols(); i++) ret.col(i) = ActFunc(cache.col(i));
+		return ret;
 	}
-	Eigen::VectorXd ActL::Backward(const Eigen::VectorXd& grads) {
-		if (grads.size() != out_sz) throw Exception("ActL::Backward: Output sizes don't match!");
+	template <typename T> Eigen::MatrixX<T> BasicActL<T>::BackwardBatch(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != out_sz) throw Exception("ActL::BackwardBatch: Output sizes don't match!");
+		if (grads.cols() != cache.cols()) throw Exception("ActL::BackwardBatch: Batch size doesn't match the previous Forward!");
+
+		Eigen::MatrixX<T> ret;
+		if (ActElemDeriv) ret = ActElemDeriv(cache).cwiseProduct(grads);
+		else {
+			ret.resize(in_sz, grads.cols());
+			for (int i = 0; i < grads.cols(); i++) ret.col(i) = ActDeriv(cache.col(i)) * grads.col(i);
+		}
 
-		Eigen::VectorXd ret = ActDeriv(cache + bias) * grads;
-		bias -= lrate * ret;
+		bias -= lrate * ret.rowwise().mean();
 		return ret;
 	}
+	template <typename T> void BasicActL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>&) const {
+		if (in.rows() != in_sz) throw Exception("ActL::Infer: Input sizes don't match!");
+		out = in.colwise() + bias;
+
+		// the built-in activations are applied in place with the same scalar math as ActFunc,
+		// any other function returns a new vector for every sample
+		if (ActFunc == Tanh<T>) out = out.unaryExpr([](T e) -> T { return tanh(e); });
+		else if (ActFunc == Sigmoid<T>) out = out.unaryExpr([](T e) -> T { return 1 / (1 + exp(-e)); });
+		else if (ActFunc == ReLU<T>) out = out.unaryExpr([](T e) -> T { return std::max(T(0), e); });
+		else if (ActFunc == Softmax<T>) {
+			for (int i = 0; i < out.cols(); i++) {
+				auto col = out.col(i).array();
+				col = (col - col.maxCoeff()).exp();
+				col /= col.sum();
+			}
+		}
+		else if (ActFunc == LogSoftmax<T>) {
+			for (int i = 0; i < out.cols(); i++) {
+				auto col = out.col(i).array();
+				T maxi = col.maxCoeff();
+				col -= maxi + log((col - maxi).exp().sum());
+			}
+		}
+		else {
+			for (int i = 0; i < out.cols(); i++) out.col(i) = ActFunc(out.col(i));
+		}
+	}
+
+	template <typename T> Eigen::MatrixX<T> BasicActL<T>::ForwardLinear(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_sz) throw Exception("ActL::ForwardLinear: Input sizes don't match!");
+		cache = in.colwise() + bias;
+		return cache;
+	}
+	template <typename T> Eigen::MatrixX<T> BasicActL<T>::BackwardLinear(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != in_sz) throw Exception("ActL::BackwardLinear: Output sizes don't match!");
+
+		bias -= lrate * grads.rowwise().mean();
+		return grads;
+	}
 
-	std::istream& ActL::Read(std::istream& istr) {
-		istr >> in_sz >> lrate >> ActFunc >> ActDeriv;
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicActL<T>::Params() {
+		return { Eigen::Map<Eigen::VectorX<T>>(bias.data(), bias.size()) };
+	}
+
+	template <typename T> std::istream& BasicActL<T>::Read(std::istream& istr) {
+		istr >> in_sz >> lrate >> ActFunc;
+		ReadActDeriv(istr, ActElemDeriv, ActDeriv);
 		out_sz = in_sz;
 
-		bias = Eigen::VectorXd(in_sz);
+		bias = Eigen::VectorX<T>(in_sz);
 		for (int i = 0; i < in_sz; i++) istr >> bias(i);
 		return istr;
 	}
-	std::ostream& ActL::Write(std::ostream& ostr) const {
-		ostr << id << '\n' << in_sz << ' ' << lrate << ' ' << ActFunc << ActDeriv << '\n' << bias << '\n';
+	template <typename T> std::ostream& BasicActL<T>::Write(std::ostream& ostr) const {
+		ostr << id << '\n' << in_sz << ' ' << lrate << ' ' << ActFunc;
+		if (ActElemDeriv) ostr << ActElemDeriv;
+		else ostr << ActDeriv;
+		ostr << '\n' << bias << '\n';
 		return ostr;
 	}
+
+	template <typename T> void BasicActL<T>::ReadBinary(BinaryReader& reader) {
+		in_sz = reader.GetSize();
+		out_sz = in_sz;
+		lrate = (T)reader.Get<double>();
+		reader.GetFunc(ActFunc);
+
+		std::istringstream deriv{ std::to_string(reader.Get<int32_t>()) };
+		ReadActDeriv(deriv, ActElemDeriv, ActDeriv);
+
+		bias = Eigen::VectorX<T>(reader.BlobSize({ in_sz }));
+		reader.GetBlob(bias.data(), bias.size());
+	}
+	template <typename T> void BasicActL<T>::WriteBinary(BinaryWriter& writer) const {
+		writer.Put<int32_t>(in_sz);
+		writer.Put<double>(lrate);
+		writer.PutFunc(ActFunc);
+		if (ActElemDeriv) writer.PutFunc(ActElemDeriv);
+		else writer.PutFunc(ActDeriv);
+		writer.PutBlob(bias.data(), bias.size());
+	}
+
+	template class BasicActL<float>;
+	template class BasicActL<double>;
 }
\ No newline at end of file
@@ -4,21 +4,33 @@
 #include "layer.h"
 
 namespace NNet {
-	class ActL : public LayerCRTP<ActL> {
+	template <typename T> class BasicActL : public LayerCRTP<BasicActL<T>, T> {
 	private:
-		vd_F_vd ActFunc;
-		md_F_vd ActDeriv;
-		Eigen::VectorXd bias, cache;
+		using BasicLayer<T>::lrate;
+		using BasicLayer<T>::in_sz;
+		using BasicLayer<T>::out_sz;
+		using BasicLayer<T>::id;
+
+		v_F_v<T> ActFunc;
+		m_F_v<T> ActDeriv;
+		m_F_m<T> ActElemDeriv;
+		Eigen::VectorX<T> bias;
+		Eigen::MatrixX<T> cache;
 	public:
-		ActL(double lrate_, vd_F_vd ActFunc_, md_F_vd ActDeriv_);
-		ActL(const ActL& other);
-		ActL(std::istream& istr);
-		~ActL() = default;
+		///ActDeriv_ is the full Jacobian, only needed for coupled activations like Softmax
+		BasicActL(T lrate_, v_F_v<T> ActFunc_, m_F_v<T> ActDeriv_);
+		///ActElemDeriv_ is the elementwise derivative, backward pass is then a cheap Hadamard product
+		BasicActL(T lrate_, v_F_v<T> ActFunc_, m_F_m<T> ActElemDeriv_);
+		BasicActL(const BasicActL& other);
+		BasicActL(std::istream& istr);
+		BasicActL(BinaryReader& reader);
+		~BasicActL() = default;
 
-		vd_F_vd GetActFunc() const;
-		md_F_vd GetActDeriv() const;
+		v_F_v<T> GetActFunc() const;
+		m_F_v<T> GetActDeriv() const;
+		m_F_m<T> GetActElemDeriv() const;
 
-		Eigen::VectorXd Bias() const;
+		Eigen::VectorX<T> Bias() const;
 
 		void InitParams(d_F GenFunc) override;
 		void SetInputSize(int input_sz) override;
@@ -26,10 +38,24 @@ namespace NNet {
 		int InSize() const;
 		int OutSize() const override;
 
-		virtual Eigen::VectorXd Forward(const Eigen::VectorXd&) override;
-		virtual Eigen::VectorXd Backward(const Eigen::VectorXd&) override;
+		virtual Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>&) override;
+		virtual Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>&) override;
+		virtual void Infer(const Eigen::MatrixX<T>&, Eigen::MatrixX<T>&, LayerWorkspace<T>&) const override;
+
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> Params() override;
+
+		///Only adds the bias (ActFunc is not applied), used by fused output stages in NeuralNet
+		Eigen::MatrixX<T> ForwardLinear(const Eigen::MatrixX<T>& in);
+		///Backward pass for gradients already taken with respect to the input of ActFunc
+		Eigen::MatrixX<T> BackwardLinear(const Eigen::MatrixX<T>& grads);
 
 		virtual std::istream& Read(std::istream&) override;
 		virtual std::ostream& Write(std::ostream&) const override;
+
+		virtual void ReadBinary(BinaryReader& reader) override;
+		virtual void WriteBinary(BinaryWriter& writer) const override;
 	};
+
+	typedef BasicActL<double> ActL;
+	typedef BasicActL<float> ActLf;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "binary_io.h"
+
+namespace NNet {
+	uint64_t Checksum(const char* data, size_t size) {
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool IsBinaryModel(const char* data, size_t size) {
+		return size >= sizeof(BINARY_MAGIC) && !std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	}
+
+	BinaryModelInfo ReadBinaryModelInfo(const char* data, size_t size, bool verify) {
+		if (!IsBinaryModel(data, size)) throw Exception("NNet::ReadBinaryModelInfo: Data is not a binary model!");
+		if (size < sizeof(BINARY_MAGIC) + sizeof(uint64_t)) throw Exception("NNet::ReadBinaryModelInfo: Data is truncated!");
+
+		BinaryReader reader{ data, size };
+		reader.Seek(size - sizeof(uint64_t));
+		if (verify && reader.Get<uint64_t>() != Checksum(data, size - sizeof(uint64_t))) throw Exception("NNet::ReadBinaryModelInfo: Checksum mismatch, the file is corrupted!");
+
+		BinaryModelInfo info;
+		reader.Seek(sizeof(BINARY_MAGIC));
+		info.version = reader.Get<uint32_t>();
+		if (info.version != BINARY_VERSION) throw Exception("NNet::ReadBinaryModelInfo: Unsupported binary model version!");
+
+		info.scalar_size = reader.Get<uint32_t>();
+		reader.SetScalarSize(info.scalar_size);
+
+		uint32_t lcnt = reader.Get<uint32_t>();
+		info.in_sz = reader.Get<uint32_t>();
+		info.out_sz = reader.Get<uint32_t>();
+		info.loss = reader.Get<int32_t>();
+		info.loss_deriv = reader.Get<int32_t>();
+
+		reader.Seek(reader.Get<uint64_t>());
+		for (uint32_t i = 0; i < lcnt; i++) {
+			const char* id = data + reader.Tell();
+			reader.Seek(reader.Tell() + BINARY_ID_SIZE);
+
+			uint64_t offset = reader.Get<uint64_t>();
+			BinaryLayerEntry entry{ std::string(id, strnlen(id, BINARY_ID_SIZE)), offset, reader.Get<uint64_t>() };
+			if (entry.offset > size || entry.size > size - entry.offset) throw Exception("NNet::ReadBinaryModelInfo: Layer record is out of bounds!");
+
+			info.layers.push_back(entry);
+		}
+
+		return info;
+	}
+}
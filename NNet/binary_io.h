@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "errors.h"
+#include "helpers.h"
+
+namespace NNet {
+	// Binary model files (version 1), numbers are stored in native byte order (little-endian on every supported target):
+	//   header   magic "NNETBIN\0", u32 version, u32 scalar size (4 = float, 8 = double), u32 layer count,
+	//            u32 input size, u32 output size, i32 loss id, i32 loss derivative id, u64 offset of the layer table
+	//   layers   one record per layer written by Layer::WriteBinary, every record and every blob starts on a
+	//            BINARY_ALIGN boundary (counted from the start of the file)
+	//   table    per layer: id padded with zeros to 16 bytes, u64 record offset, u64 record size
+	//   trailer  u64 FNV-1a checksum of all bytes before it
+	const char BINARY_MAGIC[8] = { 'N', 'N', 'E', 'T', 'B', 'I', 'N', '\0' };
+	const uint32_t BINARY_VERSION = 1;
+	const int BINARY_ALIGN = 64;
+	const int BINARY_ID_SIZE = 16;
+
+	///64-bit FNV-1a hash of size bytes
+	uint64_t Checksum(const char* data, size_t size);
+
+	///True if the data starts with BINARY_MAGIC
+	bool IsBinaryModel(const char* data, size_t size);
+
+	///Appends fields and raw arrays to an in-memory file image
+	class BinaryWriter {
+	private:
+		std::string buf;
+	public:
+		template <typename V> void Put(const V& val) {
+			static_assert(std::is_trivially_copyable<V>::value, "BinaryWriter::Put: Only plain values can be written!");
+			buf.append(reinterpret_cast<const char*>(&val), sizeof(V));
+		}
+		template <typename V> void Patch(size_t pos, const V& val) {
+			std::memcpy(&buf[pos], &val, sizeof(V));
+		}
+
+		///Pads with zeros up to the next BINARY_ALIGN boundary
+		void Align() {
+			buf.resize((buf.size() + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN, '\0');
+		}
+
+		///Aligned raw copy of n scalars
+		template <typename T> void PutBlob(const T* data, size_t n) {
+			Align();
+			buf.append(reinterpret_cast<const char*>(data), n * sizeof(T));
+		}
+
+		///Function pointers are stored by the id their stream operators use in text files
+		template <typename F> void PutFunc(const F& func) {
+			std::ostringstream str;
+			str << func;
+			Put<int32_t>(std::stoi(str.str()));
+		}
+
+		size_t Size() const { return buf.size(); }
+		const std::string& Buffer() const { return buf; }
+	};
+
+	///Reads fields and raw arrays back from a file image, every read is bounds-checked
+	class BinaryReader {
+	private:
+		const char* data;
+		size_t size, pos;
+		///Size of the scalars stored in blobs, blobs of the other scalar type are converted while reading
+		int scalar_size;
+
+		const char* Take(size_t n) {
+			if (n > size - pos) throw Exception("BinaryReader::Take: Unexpected end of data!");
+			const char* ret = data + pos;
+			pos += n;
+			return ret;
+		}
+		///Aligned blob of n scalars of the stored type, n is checked against the rest of the data before it is scaled to bytes
+		const char* TakeBlob(size_t n) {
+			Align();
+			if (n > (size - pos) / scalar_size) throw Exception("BinaryReader::TakeBlob: Unexpected end of data!");
+			return Take(n * scalar_size);
+		}
+	public:
+		BinaryReader(const char* data, size_t size, int scalar_size = sizeof(double)) : data(data), size(size), pos(0), scalar_size(scalar_size) {}
+
+		size_t Tell() const { return pos; }
+		void Seek(size_t to) {
+			if (to > size) throw Exception("BinaryReader::Seek: Position is past the end of data!");
+			pos = to;
+		}
+
+		int ScalarSize() const { return scalar_size; }
+		void SetScalarSize(int sz) {
+			if (sz != sizeof(float) && sz != sizeof(double)) throw Exception("BinaryReader::SetScalarSize: Only float and double scalars are supported!");
+			scalar_size = sz;
+		}
+
+		template <typename V> V Get() {
+			static_assert(std::is_trivially_copyable<V>::value, "BinaryReader::Get: Only plain values can be read!");
+			V ret;
+			std::memcpy(&ret, Take(sizeof(V)), sizeof(V));
+			return ret;
+		}
+
+		///Non-negative int32, used for sizes
+		int GetSize() {
+			int32_t ret = Get<int32_t>();
+			if (ret < 0) throw Exception("BinaryReader::GetSize: Negative size in data!");
+			return ret;
+		}
+
+		void Align() {
+			Seek(std::min(size, (pos + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN));
+		}
+
+		///Number of scalars in a blob with the given dimensions (sizes read from the data), throws unless it fits in the rest of the data
+		///call it before allocating for the blob, the product is checked as it is formed so it can't overflow
+		size_t BlobSize(std::initializer_list<int> dims) const {
+			size_t start = std::min(size, (pos + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN);
+			size_t cap = (size - start) / scalar_size, n = 1;
+			for (int d : dims) {
+				if (d < 0 || (d && n > cap / d)) throw Exception("BinaryReader::BlobSize: Blob doesn't fit in the data!");
+				n *= d;
+			}
+			return n;
+		}
+
+		///Copies n scalars of an aligned blob to dst
+		template <typename T> void GetBlob(T* dst, size_t n) {
+			const char* src = TakeBlob(n);
+			if (scalar_size == sizeof(T)) std::memcpy(dst, src, n * sizeof(T));
+			else if (scalar_size == sizeof(float)) {
+				for (size_t i = 0; i < n; i++) { float v; std::memcpy(&v, src + i * sizeof(float), sizeof(float)); dst[i] = (T)v; }
+			}
+			else {
+				for (size_t i = 0; i < n; i++) { double v; std::memcpy(&v, src + i * sizeof(double), sizeof(double)); dst[i] = (T)v; }
+			}
+		}
+
+		///Pointer to n scalars of an aligned blob inside the image, no copy is made
+		///only possible when the blob holds T itself
+		template <typename T> const T* MapBlob(size_t n) {
+			if (scalar_size != sizeof(T)) throw Exception("BinaryReader::MapBlob: Stored scalar type doesn't match!");
+			return reinterpret_cast<const T*>(TakeBlob(n));
+		}
+
+		template <typename F> void GetFunc(F& func) {
+			std::istringstream str{ std::to_string(Get<int32_t>()) };
+			str >> func;
+		}
+	};
+
+	///Layer record of a binary model file
+	struct BinaryLayerEntry {
+		std::string id;
+		uint64_t offset, size;
+	};
+
+	///Header fields and layer table of a binary model file
+	struct BinaryModelInfo {
+		uint32_t version, scalar_size;
+		uint32_t in_sz, out_sz;
+		int32_t loss, loss_deriv;
+		std::vector<BinaryLayerEntry> layers;
+	};
+
+	///Checks magic, version and checksum of a file image and reads its header and layer table
+	///the checksum reads every byte, verify = false skips it for images that are only touched on demand (e.g. mapped files)
+	BinaryModelInfo ReadBinaryModelInfo(const char* data, size_t size, bool verify = true);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace NNet {
+	///Lock-free ring buffer of fixed capacity for exactly one producer and one consumer thread
+	///head and tail only ever grow, each is written by one side and read with acquire by the other
+	template <typename V> class BoundedQueue {
+	private:
+		std::vector<V> slots;
+		///Kept on separate cache lines so the two threads don't invalidate each other
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) std::atomic<size_t> tail;
+	public:
+		BoundedQueue(size_t capacity) : slots(capacity ? capacity : 1), head(0), tail(0) {}
+
+		size_t Capacity() const { return slots.size(); }
+
+		///Producer side, false if the queue is full
+		bool TryPush(V& val) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == slots.size()) return false;
+			slots[t % slots.size()] = std::move(val);
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		///Consumer side, false if the queue is empty
+		bool TryPop(V& val) {
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire)) return false;
+			val = std::move(slots[h % slots.size()]);
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+	};
+
+	///Waiting strategy for the side of a BoundedQueue that has to wait: spins briefly, then yields, then sleeps
+	///so that an idle producer does not take CPU time away from the consumer
+	class Backoff {
+	private:
+		int tries = 0;
+	public:
+		void Wait() {
+			if (++tries < 16) return;
+			if (tries < 64) std::this_thread::yield();
+			else std::this_thread::sleep_for(std::chrono::microseconds(tries < 256 ? 20 : 200));
+		}
+		void Reset() { tries = 0; }
+	};
+}
@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace NNet {
+	///Temporary name next to path that no other writer uses, so a Save and a Checkpointer writing the same path don't clash
+	static std::string TempPath(const std::string& path) {
+		static std::atomic<unsigned> counter{ 0 };
+#ifdef _WIN32
+		unsigned long pid = GetCurrentProcessId();
+#else
+		long pid = getpid();
+#endif
+		return path + ".tmp." + std::to_string(pid) + '.' + std::to_string(counter++);
+	}
+
+#ifdef _WIN32
+	void WriteFileAtomic(const std::string& path, const std::string& data) {
+		std::string tmp = TempPath(path);
+		HANDLE file = CreateFileA(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) throw Exception("NNet::WriteFileAtomic: Cannot open " + tmp + "!");
+
+		for (size_t done = 0; done < data.size(); ) {
+			DWORD n = 0;
+			DWORD chunk = (DWORD)std::min<size_t>(data.size() - done, 1 << 30);
+			if (!WriteFile(file, data.data() + done, chunk, &n, nullptr)) { CloseHandle(file); DeleteFileA(tmp.c_str()); throw Exception("NNet::WriteFileAtomic: Cannot write " + tmp + "!"); }
+			done += n;
+		}
+		// the data has to reach the disk before the rename does, see the POSIX variant
+		if (!FlushFileBuffers(file)) { CloseHandle(file); DeleteFileA(tmp.c_str()); throw Exception("NNet::WriteFileAtomic: Cannot flush " + tmp + "!"); }
+		CloseHandle(file);
+
+		if (!MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) { DeleteFileA(tmp.c_str()); throw Exception("NNet::WriteFileAtomic: Cannot replace " + path + "!"); }
+	}
+#else
+	void WriteFileAtomic(const std::string& path, const std::string& data) {
+		std::string tmp = TempPath(path);
+		int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) throw Exception("NNet::WriteFileAtomic: Cannot open " + tmp + "!");
+
+		for (size_t done = 0; done < data.size(); ) {
+			ssize_t n = write(fd, data.data() + done, data.size() - done);
+			if (n < 0) { close(fd); unlink(tmp.c_str()); throw Exception("NNet::WriteFileAtomic: Cannot write " + tmp + "!"); }
+			done += n;
+		}
+		// without fsync the rename can reach the disk before the data, leaving an empty file after a crash
+		if (fsync(fd) || close(fd)) { unlink(tmp.c_str()); throw Exception("NNet::WriteFileAtomic: Cannot flush " + tmp + "!"); }
+		if (rename(tmp.c_str(), path.c_str())) { unlink(tmp.c_str()); throw Exception("NNet::WriteFileAtomic: Cannot replace " + path + "!"); }
+
+		// the rename itself is made durable by syncing the directory
+		size_t slash = path.find_last_of('/');
+		std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+		int dfd = open(dir.c_str(), O_RDONLY);
+		if (dfd >= 0) { fsync(dfd); close(dfd); }
+	}
+#endif
+
+	template <typename T> BasicCheckpointer<T>::BasicCheckpointer(const std::string& path, bool binary) :
+		path(path), binary(binary), busy(false), stop(false), written(0), dropped(0)
+	{
+		worker = std::thread(&BasicCheckpointer::Run, this);
+	}
+
+	template <typename T> BasicCheckpointer<T>::~BasicCheckpointer() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stop = true;
+		}
+		cv.notify_all();
+		worker.join();
+	}
+
+	template <typename T> void BasicCheckpointer<T>::Run() {
+		std::unique_lock<std::mutex> lock(mtx);
+		while (true) {
+			cv.wait(lock, [this] { return pending || stop; });
+			if (!pending) return;
+
+			std::unique_ptr<BasicNeuralNet<T>> net = std::move(pending);
+			busy = true;
+			lock.unlock();
+
+			std::exception_ptr err;
+			try {
+				std::ostringstream ostr;
+				if (binary) net->SaveBinary(ostr);
+				else net->Save(ostr);
+				WriteFileAtomic(path, ostr.str());
+			}
+			catch (...) { err = std::current_exception(); }
+			net.reset();
+
+			lock.lock();
+			busy = false;
+			if (err) { if (!error) error = err; }
+			else written++;
+			cv.notify_all();
+		}
+	}
+
+	template <typename T> void BasicCheckpointer<T>::ThrowError() {
+		if (!error) return;
+		std::exception_ptr err = error;
+		error = nullptr;
+		std::rethrow_exception(err);
+	}
+
+	template <typename T> void BasicCheckpointer<T>::Save(const BasicNeuralNet<T>& net) {
+		// the copy is the only work done on the caller's thread
+		std::unique_ptr<BasicNeuralNet<T>> snapshot{ new BasicNeuralNet<T>(net) };
+
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			ThrowError();
+			if (pending) dropped++;
+			pending = std::move(snapshot);
+		}
+		cv.notify_all();
+	}
+
+	template <typename T> void BasicCheckpointer<T>::Wait() {
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, [this] { return !pending && !busy; });
+		ThrowError();
+	}
+
+	template <typename T> size_t BasicCheckpointer<T>::Written() {
+		std::lock_guard<std::mutex> lock(mtx);
+		return written;
+	}
+	template <typename T> size_t BasicCheckpointer<T>::Dropped() {
+		std::lock_guard<std::mutex> lock(mtx);
+		return dropped;
+	}
+
+	template class BasicCheckpointer<float>;
+	template class BasicCheckpointer<double>;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "neural_net.h"
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace NNet {
+	///Replaces the file at path with data so that readers only ever see the old or the new contents
+	///data goes to a temporary file next to path (unique per call) first, is flushed to disk and then renamed over path
+	void WriteFileAtomic(const std::string& path, const std::string& data);
+
+	///Writes snapshots of a network to one file on a background thread
+	///Save only copies the parameters, serialization and the file write happen on the worker;
+	///a snapshot that is still waiting when the next one arrives is dropped, since only the newest one ends up in the file
+	template <typename T> class BasicCheckpointer {
+	private:
+		std::string path;
+		bool binary;
+
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::unique_ptr<BasicNeuralNet<T>> pending;
+		bool busy, stop;
+		size_t written, dropped;
+		///First failure of the worker, thrown from the next Save or Wait
+		std::exception_ptr error;
+
+		std::thread worker;
+
+		void Run();
+		void ThrowError();
+	public:
+		///binary = true writes the format of NeuralNet::SaveBinary, the text format of NeuralNet::Save otherwise
+		BasicCheckpointer(const std::string& path, bool binary = false);
+		BasicCheckpointer(const BasicCheckpointer&) = delete;
+		BasicCheckpointer& operator=(const BasicCheckpointer&) = delete;
+		///Writes the last pending snapshot before returning
+		~BasicCheckpointer();
+
+		void Save(const BasicNeuralNet<T>& net);
+		///Blocks until every snapshot that was not dropped is in the file
+		void Wait();
+
+		size_t Written();
+		size_t Dropped();
+	};
+
+	typedef BasicCheckpointer<double> Checkpointer;
+	typedef BasicCheckpointer<float> Checkpointerf;
+}
@@ -0,0 +1,443 @@
+#include "pch.h"
+#include "conv_engine.h"
+#include "fft.h"
+#include <algorithm>
+
+namespace NNet {
+	ConvShape MakeConvShape(int in_d, int in_h, int in_w, int kernel_d, int kernel_h, int kernel_w, int out_h, int out_w, Padding pad) {
+		int off_h = pad == SAME ? (kernel_h - 1) / 2 : kernel_h - 1;
+		int off_w = pad == SAME ? (kernel_w - 1) / 2 : kernel_w - 1;
+		return ConvShape{ in_d, in_h, in_w, kernel_d, kernel_h, kernel_w, out_h, out_w, off_h, off_w };
+	}
+
+	///Output positions [first, first + count) whose input position (pos + off - k) lies inside [0, in)
+	static void Overlap(int k, int off, int in, int out, int& first, int& count) {
+		first = std::max(0, k - off);
+		count = std::min(out, in + k - off) - first;
+	}
+
+	template <typename T> ConvEngine<T>::ConvEngine(const ConvShape& shape) : shape(shape) {}
+
+	template <typename T> const ConvShape& ConvEngine<T>::Shape() const { return shape; }
+
+	template <typename T> void ConvEngine<T>::KernelsChanged() {}
+
+	template <typename T> void SampleConvEngine<T>::Forward(const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& out) {
+		for (int s = 0; s < in.cols(); s++) {
+			ForwardSample(TensorView<const T>(in.col(s).data(), shape.in_d, shape.in_h, shape.in_w), kernels,
+				TensorView<T>(out.col(s).data(), shape.in_d * shape.kernel_d, shape.out_h, shape.out_w));
+		}
+	}
+	template <typename T> void SampleConvEngine<T>::Backward(const Eigen::MatrixX<T>& grads, const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& in_grads, BasicTensor<T>& kernel_grads) {
+		for (int s = 0; s < grads.cols(); s++) {
+			TensorView<const T> g(grads.col(s).data(), shape.in_d * shape.kernel_d, shape.out_h, shape.out_w);
+
+			BackwardInputSample(g, kernels, TensorView<T>(in_grads.col(s).data(), shape.in_d, shape.in_h, shape.in_w));
+			BackwardKernelSample(g, TensorView<const T>(in.col(s).data(), shape.in_d, shape.in_h, shape.in_w), kernel_grads);
+		}
+	}
+
+	// --------------- FFT --------------- //
+
+	// with p = out_h + off_h and q = in_h + kernel_h - 1 - off_h, every index that is read back below lies
+	// in [-p, q) of the linear result while the linear results themselves span less than p + q, so padding
+	// to at least max(p, q) keeps the wanted values free of circular aliasing; the kernels have to fit as well,
+	// which max(p, q) doesn't guarantee when SAME padding meets a kernel larger than the input
+	template <typename T> FFTConv<T>::FFTConv(const ConvShape& shape) : ConvEngineCRTP<FFTConv<T>, ConvEngine<T>>(shape) {
+		fft_h = std::max(2, NextPow2(std::max({ shape.out_h + shape.off_h, shape.in_h + shape.kernel_h - 1 - shape.off_h, shape.kernel_h })));
+		fft_w = NextPow2(std::max({ shape.out_w + shape.off_w, shape.in_w + shape.kernel_w - 1 - shape.off_w, shape.kernel_w }));
+	}
+
+	template <typename T> ConvAlgo FFTConv<T>::Algorithm() const { return CONV_FFT; }
+
+	template <typename T> void FFTConv<T>::KernelsChanged() { kernel_specs.clear(); }
+
+	template <typename T> void FFTConv<T>::TransformKernels(TensorView<const T> kernels) {
+		if (!kernel_specs.empty()) return;
+		for (int j = 0; j < shape.kernel_d; j++) kernel_specs.push_back(RFFT2<T>(kernels[j], fft_h, fft_w));
+	}
+	template <typename T> void FFTConv<T>::TransformInputs(const Eigen::MatrixX<T>& in) {
+		input_specs.clear();
+		for (int s = 0; s < in.cols(); s++) {
+			TensorView<const T> t(in.col(s).data(), shape.in_d, shape.in_h, shape.in_w);
+			for (int i = 0; i < shape.in_d; i++) input_specs.push_back(RFFT2<T>(t[i], fft_h, fft_w));
+		}
+	}
+
+	template <typename T> void FFTConv<T>::Forward(const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& out) {
+		TransformKernels(kernels);
+		TransformInputs(in);
+
+		for (int s = 0; s < in.cols(); s++) {
+			TensorView<T> res(out.col(s).data(), shape.in_d * shape.kernel_d, shape.out_h, shape.out_w);
+			for (int i = 0; i < shape.in_d; i++) {
+				const Eigen::MatrixX<std::complex<T>>& spec = input_specs[s * shape.in_d + i];
+				for (int j = 0; j < shape.kernel_d; j++) {
+					Eigen::MatrixX<T> conv = IRFFT2<T>(spec.cwiseProduct(kernel_specs[j]), fft_h);
+					res[i * shape.kernel_d + j] = conv.block(shape.off_h, shape.off_w, shape.out_h, shape.out_w);
+				}
+			}
+		}
+	}
+	template <typename T> void FFTConv<T>::Backward(const Eigen::MatrixX<T>& grads, const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& in_grads, BasicTensor<T>& kernel_grads) {
+		TransformKernels(kernels);
+		if (input_specs.size() != in.cols() * shape.in_d) TransformInputs(in);
+
+		int h = fft_h / 2 + 1;
+		std::vector<Eigen::MatrixX<std::complex<T>>> kernel_acc(shape.kernel_d, Eigen::MatrixX<std::complex<T>>::Zero(h, fft_w));
+
+		for (int s = 0; s < grads.cols(); s++) {
+			TensorView<const T> g(grads.col(s).data(), shape.in_d * shape.kernel_d, shape.out_h, shape.out_w);
+			TensorView<T> res(in_grads.col(s).data(), shape.in_d, shape.in_h, shape.in_w);
+
+			for (int i = 0; i < shape.in_d; i++) {
+				Eigen::MatrixX<std::complex<T>> in_acc = Eigen::MatrixX<std::complex<T>>::Zero(h, fft_w);
+				for (int j = 0; j < shape.kernel_d; j++) {
+					Eigen::MatrixX<std::complex<T>> spec = RFFT2<T>(g[i * shape.kernel_d + j], fft_h, fft_w);
+
+					in_acc += spec.cwiseProduct(kernel_specs[j].conjugate());
+					kernel_acc[j] += input_specs[s * shape.in_d + i].cwiseProduct(spec.conjugate());
+				}
+
+				// circular correlation of the gradient with the kernel, in_grads(p) is found at p - off
+				Eigen::MatrixX<T> corr = IRFFT2<T>(in_acc, fft_h);
+				auto chan = res[i];
+				for (int p = 0; p < shape.in_h; p++) {
+					for (int q = 0; q < shape.in_w; q++) chan(p, q) += corr((p - shape.off_h + fft_h) % fft_h, (q - shape.off_w + fft_w) % fft_w);
+				}
+			}
+		}
+
+		// circular correlation of the input with the gradient, kernel_grads(a) is found at off - a
+		for (int j = 0; j < shape.kernel_d; j++) {
+			Eigen::MatrixX<T> corr = IRFFT2<T>(kernel_acc[j], fft_h);
+			auto ker = kernel_grads[j];
+			for (int a = 0; a < shape.kernel_h; a++) {
+				for (int b = 0; b < shape.kernel_w; b++) ker(a, b) += corr((shape.off_h - a + fft_h) % fft_h, (shape.off_w - b + fft_w) % fft_w);
+			}
+		}
+	}
+
+	// --------------- Direct --------------- //
+
+	template <typename T> ConvAlgo DirectConv<T>::Algorithm() const { return CONV_DIRECT; }
+
+	template <typename T> void DirectConv<T>::ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) {
+		for (int i = 0; i < shape.in_d; i++) {
+			auto chan = in[i];
+			for (int j = 0; j < shape.kernel_d; j++) {
+				auto ker = kernels[j];
+				auto res = out[i * shape.kernel_d + j];
+				res.setZero();
+
+				for (int a = 0; a < shape.kernel_h; a++) {
+					int y, ny;
+					Overlap(a, shape.off_h, shape.in_h, shape.out_h, y, ny);
+					for (int b = 0; b < shape.kernel_w; b++) {
+						int x, nx;
+						Overlap(b, shape.off_w, shape.in_w, shape.out_w, x, nx);
+						if (ny <= 0 || nx <= 0) continue;
+
+						res.block(y, x, ny, nx) += ker(a, b) * chan.block(y + shape.off_h - a, x + shape.off_w - b, ny, nx);
+					}
+				}
+			}
+		}
+	}
+	template <typename T> void DirectConv<T>::BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) {
+		for (int i = 0; i < shape.in_d; i++) {
+			auto res = in_grads[i];
+			for (int j = 0; j < shape.kernel_d; j++) {
+				auto ker = kernels[j];
+				auto g = grads[i * shape.kernel_d + j];
+
+				for (int a = 0; a < shape.kernel_h; a++) {
+					int y, ny;
+					Overlap(a, shape.off_h, shape.in_h, shape.out_h, y, ny);
+					for (int b = 0; b < shape.kernel_w; b++) {
+						int x, nx;
+						Overlap(b, shape.off_w, shape.in_w, shape.out_w, x, nx);
+						if (ny <= 0 || nx <= 0) continue;
+
+						res.block(y + shape.off_h - a, x + shape.off_w - b, ny, nx) += ker(a, b) * g.block(y, x, ny, nx);
+					}
+				}
+			}
+		}
+	}
+	template <typename T> void DirectConv<T>::BackwardKernelSample(TensorView<const T> grads, TensorView<const T> in, BasicTensor<T>& kernel_grads) {
+		for (int i = 0; i < shape.in_d; i++) {
+			auto chan = in[i];
+			for (int j = 0; j < shape.kernel_d; j++) {
+				auto res = kernel_grads[j];
+				auto g = grads[i * shape.kernel_d + j];
+
+				for (int a = 0; a < shape.kernel_h; a++) {
+					int y, ny;
+					Overlap(a, shape.off_h, shape.in_h, shape.out_h, y, ny);
+					for (int b = 0; b < shape.kernel_w; b++) {
+						int x, nx;
+						Overlap(b, shape.off_w, shape.in_w, shape.out_w, x, nx);
+						if (ny <= 0 || nx <= 0) continue;
+
+						res(a, b) += g.block(y, x, ny, nx).cwiseProduct(chan.block(y + shape.off_h - a, x + shape.off_w - b, ny, nx)).sum();
+					}
+				}
+			}
+		}
+	}
+
+	// --------------- im2col --------------- //
+
+	template <typename T> void Im2col(const Eigen::Map<const MatrixRX<T>>& channel, const ConvShape& shape, Eigen::Ref<MatrixRX<T>> cols) {
+		for (int a = 0; a < shape.kernel_h; a++) {
+			int y, ny;
+			Overlap(a, shape.off_h, shape.in_h, shape.out_h, y, ny);
+			for (int b = 0; b < shape.kernel_w; b++) {
+				int x, nx;
+				Overlap(b, shape.off_w, shape.in_w, shape.out_w, x, nx);
+
+				Eigen::Map<MatrixRX<T>> row(cols.row(a * shape.kernel_w + b).data(), shape.out_h, shape.out_w);
+				row.setZero();
+				if (ny > 0 && nx > 0) row.block(y, x, ny, nx) = channel.block(y + shape.off_h - a, x + shape.off_w - b, ny, nx);
+			}
+		}
+	}
+	template <typename T> void Col2im(const Eigen::Ref<const MatrixRX<T>>& cols, const ConvShape& shape, Eigen::Map<MatrixRX<T>> channel) {
+		for (int a = 0; a < shape.kernel_h; a++) {
+			int y, ny;
+			Overlap(a, shape.off_h, shape.in_h, shape.out_h, y, ny);
+			for (int b = 0; b < shape.kernel_w; b++) {
+				int x, nx;
+				Overlap(b, shape.off_w, shape.in_w, shape.out_w, x, nx);
+				if (ny <= 0 || nx <= 0) continue;
+
+				Eigen::Map<const MatrixRX<T>> row(cols.row(a * shape.kernel_w + b).data(), shape.out_h, shape.out_w);
+				channel.block(y + shape.off_h - a, x + shape.off_w - b, ny, nx) += row.block(y, x, ny, nx);
+			}
+		}
+	}
+
+	template <typename T> Im2colConv<T>::Im2colConv(const ConvShape& shape) : ConvEngineCRTP<Im2colConv<T>, SampleConvEngine<T>>(shape),
+		cols(shape.kernel_h * shape.kernel_w, shape.out_h * shape.out_w) {}
+
+	template <typename T> ConvAlgo Im2colConv<T>::Algorithm() const { return CONV_IM2COL; }
+
+	template <typename T> void Im2colConv<T>::ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) {
+		int area = shape.out_h * shape.out_w;
+		Eigen::Map<const MatrixRX<T>> ker(kernels.Data(), shape.kernel_d, shape.kernel_h * shape.kernel_w);
+
+		for (int i = 0; i < shape.in_d; i++) {
+			Im2col<T>(in[i], shape, cols);
+
+			// output channels i * kernel_d ... i * kernel_d + kernel_d - 1 form one kernel_d x area row-major block
+			Eigen::Map<MatrixRX<T>> res(out.Data() + (std::ptrdiff_t)i * shape.kernel_d * area, shape.kernel_d, area);
+			res.noalias() = ker * cols;
+		}
+	}
+	template <typename T> void Im2colConv<T>::BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) {
+		int area = shape.out_h * shape.out_w;
+		Eigen::Map<const MatrixRX<T>> ker(kernels.Data(), shape.kernel_d, shape.kernel_h * shape.kernel_w);
+
+		for (int i = 0; i < shape.in_d; i++) {
+			Eigen::Map<const MatrixRX<T>> g(grads.Data() + (std::ptrdiff_t)i * shape.kernel_d * area, shape.kernel_d, area);
+			cols.noalias() = ker.transpose() * g;
+			Col2im<T>(cols, shape, in_grads[i]);
+		}
+	}
+	template <typename T> void Im2colConv<T>::BackwardKernelSample(TensorView<const T> grads, TensorView<const T> in, BasicTensor<T>& kernel_grads) {
+		int area = shape.out_h * shape.out_w;
+		Eigen::Map<MatrixRX<T>> res(kernel_grads.Data(), shape.kernel_d, shape.kernel_h * shape.kernel_w);
+
+		for (int i = 0; i < shape.in_d; i++) {
+			Eigen::Map<const MatrixRX<T>> g(grads.Data() + (std::ptrdiff_t)i * shape.kernel_d * area, shape.kernel_d, area);
+			Im2col<T>(in[i], shape, cols);
+			res.noalias() += g * cols.transpose();
+		}
+	}
+
+	// ----------------- END ----------------- //
+
+	// --------------- Winograd --------------- //
+
+	// ConvL convolves, so the forward pass is a correlation with the flipped kernel over the input shifted by
+	// off - 2, while the input gradient is a correlation of the output gradient with the kernel itself, shifted by -off
+
+	template <typename T> using EvenMap = Eigen::Map<Eigen::RowVectorX<T>, 0, Eigen::InnerStride<2>>;
+	template <typename T> using ConstEvenMap = Eigen::Map<const Eigen::RowVectorX<T>, 0, Eigen::InnerStride<2>>;
+
+	template <typename T> WinogradConv<T>::WinogradConv(const ConvShape& shape) : ConvEngineCRTP<WinogradConv<T>, DirectConv<T>>(shape) {
+		if (shape.kernel_h != 3 || shape.kernel_w != 3) throw Exception("WinogradConv::WinogradConv: Only 3x3 kernels are supported!");
+	}
+
+	template <typename T> ConvAlgo WinogradConv<T>::Algorithm() const { return CONV_WINOGRAD; }
+
+	template <typename T> void WinogradConv<T>::KernelsChanged() {
+		fwd_filters.resize(0, 0);
+		bwd_filters.resize(0, 0);
+	}
+
+	///U = G g G^T with G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1], element (u, v) is stored at 4 * u + v
+	template <typename T> static Eigen::VectorX<T> FilterTransform(const Eigen::Matrix3<T>& g) {
+		Eigen::Matrix<T, 4, 3> G;
+		G << 1, 0, 0,
+			T(0.5), T(0.5), T(0.5),
+			T(0.5), T(-0.5), T(0.5),
+			0, 0, 1;
+
+		Eigen::Matrix<T, 4, 4, Eigen::RowMajor> u = G * g * G.transpose();
+		return Eigen::Map<Eigen::VectorX<T>>(u.data(), 16);
+	}
+
+	template <typename T> void WinogradConv<T>::TransformKernels(TensorView<const T> kernels) {
+		if (fwd_filters.size()) return;
+
+		fwd_filters.resize(16, shape.kernel_d);
+		bwd_filters.resize(16, shape.kernel_d);
+		for (int j = 0; j < shape.kernel_d; j++) {
+			Eigen::Matrix3<T> ker = kernels[j];
+			fwd_filters.col(j) = FilterTransform<T>(ker.reverse());
+			bwd_filters.col(j) = FilterTransform<T>(ker);
+		}
+	}
+
+	///spec = B^T d B with B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1] for every 4x4 tile d of src
+	///tile (ty, tx) starts at (first_h + 2 * ty, first_w + 2 * tx), its element (u, v) goes to spec(4 * u + v, ty * tiles_w + tx)
+	template <typename T> void WinogradConv<T>::InputTransform(const Eigen::Map<const MatrixRX<T>>& src, int first_h, int first_w, int tiles_h, int tiles_w) {
+		// zero padded copy of the covered area, split into even and odd columns (relative to first_w)
+		even = MatrixRX<T>::Zero(2 * tiles_h + 2, tiles_w + 1);
+		odd = MatrixRX<T>::Zero(2 * tiles_h + 2, tiles_w + 1);
+
+		int y = std::max(0, first_h), x = std::max(0, first_w);
+		int h = std::min<int>(src.rows(), first_h + even.rows()) - y, w = std::min<int>(src.cols(), first_w + 2 * even.cols()) - x;
+		for (int k = 0; k < h && w > 0; k++) {
+			int c = x - first_w;
+			ConstEvenMap<T> first(src.row(y + k).data() + x, (w + 1) / 2), second(src.row(y + k).data() + x + 1, w / 2);
+			(c % 2 ? odd : even).row(y + k - first_h).segment(c / 2, first.size()) = first;
+			(c % 2 ? even : odd).row(y + k - first_h).segment((c + 1) / 2, second.size()) = second;
+		}
+
+		spec.resize(16, tiles_h * tiles_w);
+		rows_even.resize(4, tiles_w + 1);
+		rows_odd.resize(4, tiles_w + 1);
+		for (int ty = 0; ty < tiles_h; ty++) {
+			// B^T over the rows of the whole tile row at once, then B over the columns of each tile
+			for (int k = 0; k < 2; k++) {
+				auto p = (k ? odd : even).middleRows(2 * ty, 4);
+				MatrixRX<T>& r = k ? rows_odd : rows_even;
+				r.row(0) = p.row(0) - p.row(2);
+				r.row(1) = p.row(1) + p.row(2);
+				r.row(2) = p.row(2) - p.row(1);
+				r.row(3) = p.row(1) - p.row(3);
+			}
+
+			for (int u = 0; u < 4; u++) {
+				auto d0 = rows_even.row(u).head(tiles_w), d1 = rows_odd.row(u).head(tiles_w);
+				auto d2 = rows_even.row(u).tail(tiles_w), d3 = rows_odd.row(u).tail(tiles_w);
+
+				spec.row(4 * u).segment(ty * tiles_w, tiles_w) = d0 - d2;
+				spec.row(4 * u + 1).segment(ty * tiles_w, tiles_w) = d1 + d2;
+				spec.row(4 * u + 2).segment(ty * tiles_w, tiles_w) = d2 - d1;
+				spec.row(4 * u + 3).segment(ty * tiles_w, tiles_w) = d1 - d3;
+			}
+		}
+	}
+
+	///Adds A^T (filter .* m) A with A^T = [1 1 1 0; 0 1 -1 -1] to dst, parts of 2x2 tiles that stick out of dst are dropped
+	template <typename T> void WinogradConv<T>::OutputTransform(const MatrixRX<T>& m, const Eigen::VectorX<T>& filter, Eigen::Map<MatrixRX<T>> dst) {
+		int tiles_w = (dst.cols() + 1) / 2, tiles_h = m.cols() / tiles_w;
+
+		even.resize(2 * tiles_h, tiles_w);
+		odd.resize(2 * tiles_h, tiles_w);
+		rows_even.resize(8, tiles_w);
+		for (int ty = 0; ty < tiles_h; ty++) {
+			auto r = [&](int k) { return filter(k) * m.row(k).segment(ty * tiles_w, tiles_w); };
+			for (int v = 0; v < 4; v++) {
+				rows_even.row(v) = r(v) + r(4 + v) + r(8 + v);
+				rows_even.row(4 + v) = r(4 + v) - r(8 + v) - r(12 + v);
+			}
+
+			for (int p = 0; p < 2; p++) {
+				auto a = rows_even.middleRows(4 * p, 4);
+				even.row(2 * ty + p) = a.row(0) + a.row(1) + a.row(2);
+				odd.row(2 * ty + p) = a.row(1) - a.row(2) - a.row(3);
+			}
+		}
+
+		for (int y = 0; y < dst.rows(); y++) {
+			EvenMap<T>(dst.row(y).data(), tiles_w) += even.row(y);
+			EvenMap<T>(dst.row(y).data() + 1, dst.cols() / 2) += odd.row(y).head(dst.cols() / 2);
+		}
+	}
+
+	template <typename T> void WinogradConv<T>::ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) {
+		TransformKernels(kernels);
+
+		int tiles_h = (shape.out_h + 1) / 2, tiles_w = (shape.out_w + 1) / 2;
+		for (int i = 0; i < shape.in_d; i++) {
+			InputTransform(in[i], shape.off_h - 2, shape.off_w - 2, tiles_h, tiles_w);
+
+			// spec is shared by all kernels, the filter product is fused into the output transform
+			for (int j = 0; j < shape.kernel_d; j++) {
+				auto res = out[i * shape.kernel_d + j];
+				res.setZero();
+				OutputTransform(spec, fwd_filters.col(j), res);
+			}
+		}
+	}
+	template <typename T> void WinogradConv<T>::BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) {
+		TransformKernels(kernels);
+
+		// the products of all kernels applied to one input channel are summed before a single output transform
+		int tiles_h = (shape.in_h + 1) / 2, tiles_w = (shape.in_w + 1) / 2;
+		for (int i = 0; i < shape.in_d; i++) {
+			acc = MatrixRX<T>::Zero(16, tiles_h * tiles_w);
+			for (int j = 0; j < shape.kernel_d; j++) {
+				InputTransform(grads[i * shape.kernel_d + j], -shape.off_h, -shape.off_w, tiles_h, tiles_w);
+				acc += bwd_filters.col(j).asDiagonal() * spec;
+			}
+			OutputTransform(acc, Eigen::VectorX<T>::Ones(16), in_grads[i]);
+		}
+	}
+
+	template <typename T> ConvEngine<T>* MakeConvEngine(ConvAlgo algo, const ConvShape& shape) {
+		if (algo == CONV_AUTO) {
+			// FFT2 pads to powers of 2 and needs three transforms per pair, so it only wins for large kernels
+			int n = 1, m = 1;
+			while (n < shape.in_h + shape.kernel_h - 1) n *= 2;
+			while (m < shape.in_w + shape.kernel_w - 1) m *= 2;
+
+			double fft_cost = 15. * n * m * log2(n * m);
+			double direct_cost = 2. * shape.out_h * shape.out_w * shape.kernel_h * shape.kernel_w;
+			algo = (fft_cost < direct_cost) ? CONV_FFT : CONV_IM2COL;
+		}
+
+		switch (algo) {
+		case CONV_FFT: return new FFTConv<T>(shape);
+		case CONV_DIRECT: return new DirectConv<T>(shape);
+		case CONV_IM2COL: return new Im2colConv<T>(shape);
+		case CONV_WINOGRAD: return new WinogradConv<T>(shape);
+		default: throw Exception("NNet::MakeConvEngine: Unknown convolution algorithm!");
+		}
+	}
+
+	template class ConvEngine<float>;
+	template class ConvEngine<double>;
+	template class SampleConvEngine<float>;
+	template class SampleConvEngine<double>;
+	template class FFTConv<float>;
+	template class FFTConv<double>;
+	template class DirectConv<float>;
+	template class DirectConv<double>;
+	template class Im2colConv<float>;
+	template class Im2colConv<double>;
+	template class WinogradConv<float>;
+	template class WinogradConv<double>;
+
+	template void Im2col<float>(const Eigen::Map<const MatrixRXf>&, const ConvShape&, Eigen::Ref<MatrixRXf>);
+	template void Im2col<double>(const Eigen::Map<const MatrixRXd>&, const ConvShape&, Eigen::Ref<MatrixRXd>);
+	template void Col2im<float>(const Eigen::Ref<const MatrixRXf>&, const ConvShape&, Eigen::Map<MatrixRXf>);
+	template void Col2im<double>(const Eigen::Ref<const MatrixRXd>&, const ConvShape&, Eigen::Map<MatrixRXd>);
+	template ConvEngine<float>* MakeConvEngine<float>(ConvAlgo, const ConvShape&);
+	template ConvEngine<double>* MakeConvEngine<double>(ConvAlgo, const ConvShape&);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "helpers.h"
+#include "tensor.h"
+
+namespace NNet {
+	enum Padding{VALID, SAME};
+
+	///CONV_AUTO picks FFT for large kernels and im2col + GEMM otherwise, CONV_WINOGRAD needs 3x3 kernels
+	enum ConvAlgo{CONV_AUTO, CONV_FFT, CONV_DIRECT, CONV_IM2COL, CONV_WINOGRAD};
+
+	///Geometry of a ConvL: every one of kernel_d kernels is applied to each of in_d input channels
+	///output channel i * kernel_d + j is the full 2D convolution of input channel i with kernel j,
+	///cropped to out_h x out_w starting at (off_h, off_w)
+	struct ConvShape {
+		int in_d, in_h, in_w;
+		int kernel_d, kernel_h, kernel_w;
+		int out_h, out_w;
+		int off_h, off_w;
+	};
+
+	///Fills every field of a ConvShape, the crop offsets follow from the padding
+	ConvShape MakeConvShape(int in_d, int in_h, int in_w, int kernel_d, int kernel_h, int kernel_w, int out_h, int out_w, Padding pad);
+
+	///Convolution backend of a ConvL over scalar type T, batches hold one sample per column
+	template <typename T> class ConvEngine {
+	protected:
+		ConvShape shape;
+	public:
+		typedef T Scalar;
+
+		ConvEngine(const ConvShape& shape);
+		virtual ~ConvEngine() = default;
+
+		virtual ConvEngine* Clone() const = 0;
+		virtual ConvAlgo Algorithm() const = 0;
+
+		const ConvShape& Shape() const;
+
+		///Has to be called whenever the kernels change, engines may keep transformed kernels until then
+		virtual void KernelsChanged();
+
+		///out must have in_d * kernel_d channels of out_h x out_w per column
+		virtual void Forward(const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& out) = 0;
+		///in is the batch of the previous Forward, gradients are added to in_grads and kernel_grads
+		virtual void Backward(const Eigen::MatrixX<T>& grads, const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& in_grads, BasicTensor<T>& kernel_grads) = 0;
+	};
+
+	template <typename EType, typename Base> class ConvEngineCRTP : public Base {
+	public:
+		using Base::Base;
+
+		ConvEngine<typename Base::Scalar>* Clone() const override {
+			return new EType(static_cast<const EType&>(*this));
+		}
+	};
+
+	///Engine that handles a batch one sample at a time
+	template <typename T> class SampleConvEngine : public ConvEngine<T> {
+	protected:
+		using ConvEngine<T>::shape;
+
+		virtual void ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) = 0;
+		virtual void BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) = 0;
+		virtual void BackwardKernelSample(TensorView<const T> grads, TensorView<const T> in, BasicTensor<T>& kernel_grads) = 0;
+	public:
+		using ConvEngine<T>::ConvEngine;
+
+		void Forward(const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& out) override;
+		void Backward(const Eigen::MatrixX<T>& grads, const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& in_grads, BasicTensor<T>& kernel_grads) override;
+	};
+
+	///Pointwise products of real-input 2D spectra, all padded to one common size
+	///input spectra are computed once per Forward and reused by Backward, kernel spectra are kept until
+	///the kernels change, and gradients are summed in the frequency domain before transforming back
+	template <typename T> class FFTConv : public ConvEngineCRTP<FFTConv<T>, ConvEngine<T>> {
+	private:
+		using ConvEngine<T>::shape;
+
+		int fft_h, fft_w;
+		std::vector<Eigen::MatrixX<std::complex<T>>> kernel_specs, input_specs;
+
+		void TransformKernels(TensorView<const T> kernels);
+		void TransformInputs(const Eigen::MatrixX<T>& in);
+	public:
+		FFTConv(const ConvShape& shape);
+
+		ConvAlgo Algorithm() const override;
+
+		void KernelsChanged() override;
+
+		void Forward(const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& out) override;
+		void Backward(const Eigen::MatrixX<T>& grads, const Eigen::MatrixX<T>& in, TensorView<const T> kernels, Eigen::MatrixX<T>& in_grads, BasicTensor<T>& kernel_grads) override;
+	};
+
+	///Shifted multiply-adds over whole channels, one per kernel element
+	template <typename T> class DirectConv : public ConvEngineCRTP<DirectConv<T>, SampleConvEngine<T>> {
+	protected:
+		using ConvEngine<T>::shape;
+
+		void ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) override;
+		void BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) override;
+		void BackwardKernelSample(TensorView<const T> grads, TensorView<const T> in, BasicTensor<T>& kernel_grads) override;
+	public:
+		using ConvEngineCRTP<DirectConv<T>, SampleConvEngine<T>>::ConvEngineCRTP;
+
+		ConvAlgo Algorithm() const override;
+	};
+
+	///Unrolls a channel into the (kernel_h * kernel_w) x (out_h * out_w) patch matrix cols,
+	///row a * kernel_w + b holds the input pixels that kernel element (a, b) is multiplied with, only the spatial part of shape is used
+	template <typename T> void Im2col(const Eigen::Map<const MatrixRX<T>>& channel, const ConvShape& shape, Eigen::Ref<MatrixRX<T>> cols);
+	///Adjoint of Im2col, adds every patch entry of cols back to the channel pixel it was taken from
+	template <typename T> void Col2im(const Eigen::Ref<const MatrixRX<T>>& cols, const ConvShape& shape, Eigen::Map<MatrixRX<T>> channel);
+
+	///Unrolls each input channel into a patch matrix so that all kernels are applied to it with a single GEMM
+	template <typename T> class Im2colConv : public ConvEngineCRTP<Im2colConv<T>, SampleConvEngine<T>> {
+	private:
+		using ConvEngine<T>::shape;
+
+		MatrixRX<T> cols;
+	protected:
+		void ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) override;
+		void BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) override;
+		void BackwardKernelSample(TensorView<const T> grads, TensorView<const T> in, BasicTensor<T>& kernel_grads) override;
+	public:
+		Im2colConv(const ConvShape& shape);
+
+		ConvAlgo Algorithm() const override;
+	};
+
+	///Winograd F(2x2, 3x3) minimal filtering for 3x3 kernels, every 2x2 output tile is computed from a
+	///4x4 input tile with 16 multiplications instead of 36
+	///the tiles of a channel are transformed together into a 16 x tiles matrix and even and odd columns are split up
+	///front, so every step is a contiguous row operation;
+	///transformed kernels are kept until the kernels change, kernel gradients are left to the direct engine
+	template <typename T> class WinogradConv : public ConvEngineCRTP<WinogradConv<T>, DirectConv<T>> {
+	private:
+		using ConvEngine<T>::shape;
+
+		Eigen::MatrixX<T> fwd_filters, bwd_filters;
+		MatrixRX<T> even, odd, rows_even, rows_odd, spec, acc;
+
+		void TransformKernels(TensorView<const T> kernels);
+		void InputTransform(const Eigen::Map<const MatrixRX<T>>& src, int first_h, int first_w, int tiles_h, int tiles_w);
+		void OutputTransform(const MatrixRX<T>& m, const Eigen::VectorX<T>& filter, Eigen::Map<MatrixRX<T>> dst);
+	protected:
+		void ForwardSample(TensorView<const T> in, TensorView<const T> kernels, TensorView<T> out) override;
+		void BackwardInputSample(TensorView<const T> grads, TensorView<const T> kernels, TensorView<T> in_grads) override;
+	public:
+		WinogradConv(const ConvShape& shape);
+
+		ConvAlgo Algorithm() const override;
+
+		void KernelsChanged() override;
+	};
+
+	///Resolves CONV_AUTO and constructs the engine, caller takes ownership
+	template <typename T> ConvEngine<T>* MakeConvEngine(ConvAlgo algo, const ConvShape& shape);
+}
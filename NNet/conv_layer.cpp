@@ -1,122 +1,174 @@
 #include "pch.h"
 #include "conv_layer.h"
+#include "conv_tuner.h"
+#include <atomic>
 
 namespace NNet {
-	void ConvL::CalcOutSizes() {
+	///Versions are unique across all layers, so a workspace used with another net can't mistake a stale engine for current
+	static unsigned long long NextVersion() {
+		static std::atomic<unsigned long long> counter{ 0 };
+		return ++counter;
+	}
+
+	template <typename T> void BasicConvL<T>::CalcOutSizes() {
 		out_d = in_d * kernel_d;
-		if (pad == SAME) { out_h = in_h; out_w = out_h; }
+		if (pad == SAME) { out_h = in_h; out_w = in_w; }
 		else if (pad == VALID) { out_h = in_h - kernel_h + 1; out_w = in_w - kernel_w + 1; }
+
+		engine.reset(MakeConvEngine<T>(algo, Shape()));
+		version = NextVersion();
+		tuned = false;
 	}
 
-	ConvL::ConvL(double lrate_, int input_h, int input_w, int kernel_d, int kernel_h, int kernel_w, Padding pad) : 
-		in_h(input_h), in_w(input_w), kernel_d(kernel_d), kernel_h(kernel_h), kernel_w(kernel_w), pad(pad)
+	template <typename T> BasicConvL<T>::BasicConvL(T lrate_, int input_h, int input_w, int kernel_d, int kernel_h, int kernel_w, Padding pad, ConvAlgo algo) : 
+		in_h(input_h), in_w(input_w), kernel_d(kernel_d), kernel_h(kernel_h), kernel_w(kernel_w), pad(pad), algo(algo)
 	{
 		lrate = lrate_;
 		id = "Conv";
 	}
-	ConvL::ConvL(const ConvL& other) {
+	template <typename T> BasicConvL<T>::BasicConvL(const BasicConvL& other) {
 		in_d = other.InDepth();
 		in_h = other.InHeight();
 		in_w = other.InWidth();
 
 		kernels = other.Kernels();
-		kernel_d = kernels.size();
-		kernel_h = kernels[0].rows();
-		kernel_w = kernels[0].cols();
+		kernel_d = kernels.Depth();
+		kernel_h = kernels.Height();
+		kernel_w = kernels.Width();
 
 		lrate = other.LRate();
 		pad = other.GetPadding();
+		algo = other.algo;
 
 		CalcOutSizes();
+		// a tuned CONV_AUTO layer hands over the engine it settled on, an untuned one stays on CONV_AUTO and tunes on first use
+		tuned = other.tuned;
+		if (tuned && other.engine && other.engine->Algorithm() != engine->Algorithm()) engine.reset(MakeConvEngine<T>(other.engine->Algorithm(), Shape()));
 
 		id = "Conv";
 	}
-	ConvL::ConvL(std::istream& istr) {
+	template <typename T> BasicConvL<T>::BasicConvL(std::istream& istr) {
 		id = "Conv";
+		algo = CONV_AUTO;
 		Read(istr);
 	}
+	template <typename T> BasicConvL<T>::BasicConvL(BinaryReader& reader) {
+		id = "Conv";
+		algo = CONV_AUTO;
+		ReadBinary(reader);
+	}
 	
-	int ConvL::InDepth() const { return in_d; }
-	int ConvL::InHeight() const { return in_h; }
-	int ConvL::InWidth() const { return in_w; }
+	template <typename T> int BasicConvL<T>::InDepth() const { return in_d; }
+	template <typename T> int BasicConvL<T>::InHeight() const { return in_h; }
+	template <typename T> int BasicConvL<T>::InWidth() const { return in_w; }
+
+	template <typename T> Padding BasicConvL<T>::GetPadding() const { return pad; }
+	template <typename T> BasicTensor<T> BasicConvL<T>::Kernels() const { return kernels; }
 
-	Padding ConvL::GetPadding() const { return pad; }
-	std::vector<Eigen::MatrixXd> ConvL::Kernels() const { return kernels; }
+	template <typename T> ConvShape BasicConvL<T>::Shape() const {
+		return MakeConvShape(in_d, in_h, in_w, kernel_d, kernel_h, kernel_w, out_h, out_w, pad);
+	}
 
-	void ConvL::SetInputSize(int in_sz) {
+	template <typename T> ConvAlgo BasicConvL<T>::Algorithm() const { return engine ? engine->Algorithm() : algo; }
+	template <typename T> void BasicConvL<T>::SetAlgorithm(ConvAlgo algo_) {
+		algo = algo_;
+		if (engine) engine.reset(MakeConvEngine<T>(algo, Shape()));
+		version = NextVersion();
+		tuned = false;
+	}
+	template <typename T> void BasicConvL<T>::Autotune() {
+		tuned = true;
+		if (algo != CONV_AUTO || !engine) return;
+
+		ConvAlgo best = TunedConvAlgo<T>(Shape());
+		if (best != CONV_AUTO && best != engine->Algorithm()) {
+			engine.reset(MakeConvEngine<T>(best, Shape()));
+			version = NextVersion();
+		}
+	}
+
+	template <typename T> void BasicConvL<T>::SetInputSize(int in_sz) {
 		if (in_sz % (in_h * in_w)) throw Exception("ConvL::SetInputSize: Make sure total input size is divisible by the product of input height and width!");
 		in_d = in_sz / (in_h * in_w);
 		CalcOutSizes();
 	}
-	void ConvL::InitParams(d_F GenFunc) {
-		kernels.clear();
+	template <typename T> void BasicConvL<T>::InitParams(d_F GenFunc) {
+		kernels = BasicTensor<T>(kernel_d, kernel_h, kernel_w);
 		for (int i = 0; i < kernel_d; i++) {
-			kernels.push_back(Eigen::MatrixXd(kernel_h, kernel_w));
 			for (int j = 0; j < kernel_h; j++) {
 				for (int k = 0; k < kernel_w; k++) kernels[i](j, k) = GenFunc();
 			}
 		}
+		if (engine) engine->KernelsChanged();
+		version = NextVersion();
 	}
-	int ConvL::OutSize() const {
+	template <typename T> int BasicConvL<T>::OutSize() const {
 		return out_d * out_h * out_w;
 	}
 
-	Eigen::VectorXd ConvL::Forward(const Eigen::VectorXd& in) {
-		if (in.size() != in_d * in_h * in_w) throw Exception("ConvL::Forward: Input size doesn't match!");
-		auto t = VecTo3D(in, in_d, in_h, in_w);
-		cache = t;
+	template <typename T> Eigen::MatrixX<T> BasicConvL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_d * in_h * in_w) throw Exception("ConvL::ForwardBatch: Input size doesn't match!");
+		if (!tuned) Autotune();
+		cache = in;
 
-		std::vector<Eigen::MatrixXd> ret;
-		for (int i = 0; i < in_d; i++) {
-			for (int j = 0; j < kernel_d; j++) {
-				Eigen::MatrixXd res = Convolve2D(t[i], kernels[j]);
-				if (pad == SAME) ret.push_back(res.block((kernel_h - 1) / 2, (kernel_w - 1) / 2, out_h, out_w));
-				else if (pad == VALID) ret.push_back(res.block(kernel_h - 1, kernel_w - 1, out_h, out_w));
-			}
+		Eigen::MatrixX<T> out(OutSize(), in.cols());
+		engine->Forward(in, kernels, out);
+
+		return out;
+	}
+	template <typename T> void BasicConvL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const {
+		if (in.rows() != in_d * in_h * in_w) throw Exception("ConvL::Infer: Input size doesn't match!");
+		if (!ws.engine || ws.version != version) {
+			// Infer never benchmarks, an untuned layer only picks up a result that is already known for its shape
+			ConvAlgo best = tuned || algo != CONV_AUTO ? CONV_AUTO : CachedConvAlgo<T>(Shape());
+			if (best != CONV_AUTO && best != engine->Algorithm()) ws.engine.reset(MakeConvEngine<T>(best, Shape()));
+			else ws.engine.reset(engine->Clone());
+			ws.version = version;
 		}
 
-		return ThreeDToVec(ret);
+		out.resize(OutSize(), in.cols());
+		ws.engine->Forward(in, kernels, out);
 	}
-	Eigen::VectorXd ConvL::Backward(const Eigen::VectorXd& grads) {
-		if (grads.size() != out_d * out_h * out_w) throw Exception("ConvL::Backward: Gradient list is not the right size!");
-		auto g = VecTo3D(grads, out_d, out_h, out_w);
+	template <typename T> Eigen::MatrixX<T> BasicConvL<T>::BackwardBatch(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != out_d * out_h * out_w) throw Exception("ConvL::BackwardBatch: Gradient list is not the right size!");
+		if (grads.cols() != cache.cols()) throw Exception("ConvL::BackwardBatch: Batch size doesn't match the previous Forward!");
 
-		std::vector<Eigen::MatrixXd> ret;
-		for (int i = 0; i < in_d; i++) {
-			ret.push_back(Eigen::MatrixXd::Zero(in_h, in_w));
-			for (int j = 0; j < kernel_d; j++) {
-				auto res = Convolve2D(g[i * kernel_d + j], kernels[j].reverse());
-				if (pad == SAME) ret[i] += res.block((kernel_h - 1) / 2, (kernel_w - 1) / 2, in_h, in_w);
-				else if (pad == VALID) ret[i] += res;
-			}
-		}
+		BasicTensor<T> kgrads(kernel_d, kernel_h, kernel_w);
+		kgrads.SetZero();
 
-		for (int j = 0; j < kernel_d; j++) {
-			for (int i = 0; i < in_d; i++) {
-				auto res = Convolve2D(g[i * kernel_d + j], cache[i]);
-				int midx = res.rows() / 2 - kernel_h / 2;
-				int midy = res.cols() / 2 - kernel_w / 2;
+		Eigen::MatrixX<T> out = Eigen::MatrixX<T>::Zero(in_d * in_h * in_w, grads.cols());
+		engine->Backward(grads, cache, kernels, out, kgrads);
 
-				kernels[j] -= lrate * res.block(midx, midy, kernel_h, kernel_w);
-			}
-		}
+		for (int j = 0; j < kernel_d; j++) kernels[j] -= (lrate / grads.cols()) * kgrads[j];
+		engine->KernelsChanged();
+		version = NextVersion();
 
-		return ThreeDToVec(ret);
+		return out;
 	}
 
-	std::istream& ConvL::Read(std::istream& istr) {
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicConvL<T>::Params() {
+		return { Eigen::Map<Eigen::VectorX<T>>(kernels.Data(), kernels.Flat().size()) };
+	}
+	template <typename T> void BasicConvL<T>::ParamsChanged() {
+		if (engine) engine->KernelsChanged();
+		version = NextVersion();
+	}
+
+	template <typename T> std::istream& BasicConvL<T>::Read(std::istream& istr) {
 		istr >> in_d >> in_h >> in_w >> kernel_d >> kernel_w >> kernel_h;
 		int a;
 		istr >> a;
 		if (a < 0 || a >= 2) throw Exception("ConvL::Read: Invalid data given to read from stream!");
 		pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("ConvL::Read: Input and kernel sizes in the data don't fit together!");
         istr >> lrate;
 
 		CalcOutSizes();
 
-		kernels.clear();
+		kernels = BasicTensor<T>(kernel_d, kernel_h, kernel_w);
 		for (int i = 0; i < kernel_d; i++) {
-			kernels.push_back(Eigen::MatrixXd{ kernel_h, kernel_w });
 			for (int j = 0; j < kernel_h; j++) {
 				for (int k = 0; k < kernel_w; k++) istr >> kernels[i](j, k);
 			}
@@ -125,7 +177,7 @@ namespace NNet {
 		return istr;
 	}
 
-	std::ostream& ConvL::Write(std::ostream& ostr) const {
+	template <typename T> std::ostream& BasicConvL<T>::Write(std::ostream& ostr) const {
 		ostr << id << '\n';
         ostr << in_d << ' ' << in_h << ' ' << in_w << '\n' << kernel_d << ' ' << kernel_w << ' ' << kernel_h << '\n' << pad << '\n' << lrate << '\n';
 
@@ -133,4 +185,35 @@ namespace NNet {
 
 		return ostr;
 	}
+
+	template <typename T> void BasicConvL<T>::ReadBinary(BinaryReader& reader) {
+		in_d = reader.GetSize();
+		in_h = reader.GetSize();
+		in_w = reader.GetSize();
+		kernel_d = reader.GetSize();
+		kernel_h = reader.GetSize();
+		kernel_w = reader.GetSize();
+		int a = reader.Get<int32_t>();
+		if (a < 0 || a >= 2) throw Exception("ConvL::ReadBinary: Invalid data given to read from!");
+		pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("ConvL::ReadBinary: Input and kernel sizes in the data don't fit together!");
+		lrate = (T)reader.Get<double>();
+		reader.BlobSize({ kernel_d, kernel_h, kernel_w });
+
+		CalcOutSizes();
+
+		kernels = BasicTensor<T>(kernel_d, kernel_h, kernel_w);
+		reader.GetBlob(kernels.Data(), kernels.Flat().size());
+		version = NextVersion();
+	}
+	template <typename T> void BasicConvL<T>::WriteBinary(BinaryWriter& writer) const {
+		for (int v : { in_d, in_h, in_w, kernel_d, kernel_h, kernel_w, (int)pad }) writer.Put<int32_t>(v);
+		writer.Put<double>(lrate);
+		writer.PutBlob(kernels.Data(), kernels.Flat().size());
+	}
+
+	template class BasicConvL<float>;
+	template class BasicConvL<double>;
 }
\ No newline at end of file
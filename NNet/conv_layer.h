@@ -2,39 +2,71 @@
 
 #include "layer.h"
 #include "helpers.h"
+#include "conv_engine.h"
+#include <memory>
 
 namespace NNet {
-	enum Padding{VALID, SAME};
-
-	class ConvL : public LayerCRTP<ConvL> {
+	template <typename T> class BasicConvL : public LayerCRTP<BasicConvL<T>, T> {
 	private:
+		using BasicLayer<T>::lrate;
+		using BasicLayer<T>::id;
+
 		int in_d, in_h, in_w;
 		int out_d, out_h, out_w;
 		int kernel_d, kernel_h, kernel_w;
 		Padding pad;
-		std::vector<Eigen::MatrixXd> kernels, cache;
+		BasicTensor<T> kernels;
+		Eigen::MatrixX<T> cache;
+
+		ConvAlgo algo;
+		std::unique_ptr<ConvEngine<T>> engine;
+		///Renewed whenever the kernels or the engine change, tells Infer workspaces to copy the engine again
+		unsigned long long version = 0;
+		///Set once Autotune ran for the current engine, until then ForwardBatch tunes on its first call
+		bool tuned = false;
 
 		void CalcOutSizes();
 	public:
-		ConvL(double lrate, int input_h, int input_w, int kernel_d, int kernel_h, int kernel_w, Padding pad);
-		ConvL(const ConvL& other);
-		ConvL(std::istream& istr);
+		BasicConvL(T lrate, int input_h, int input_w, int kernel_d, int kernel_h, int kernel_w, Padding pad, ConvAlgo algo = CONV_AUTO);
+		BasicConvL(const BasicConvL& other);
+		BasicConvL(std::istream& istr);
+		BasicConvL(BinaryReader& reader);
 
 		int InDepth() const;
 		int InHeight() const;
 		int InWidth() const;
 
 		Padding GetPadding() const;
-		std::vector<Eigen::MatrixXd> Kernels() const;
+		BasicTensor<T> Kernels() const;
+
+		ConvShape Shape() const;
+
+		///Convolution backend in use (CONV_AUTO is resolved once input size is known)
+		ConvAlgo Algorithm() const;
+		void SetAlgorithm(ConvAlgo algo);
+		///Swaps in the measured fastest engine if the layer was left on CONV_AUTO, see TunedConvAlgo
+		///runs on its own before the first forward pass, calling it earlier keeps the benchmark out of the first batch
+		///Infer never tunes (it only reuses cached results), so serving code has to call NeuralNet::Autotune first
+		void Autotune();
 
 		void SetInputSize(int in_sz) override;
 		void InitParams(d_F GenFunc) override;
 		int OutSize() const override;
 
-		Eigen::VectorXd Forward(const Eigen::VectorXd& in) override;
-		Eigen::VectorXd Backward(const Eigen::VectorXd& grads) override;
+		Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>& in) override;
+		Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>& grads) override;
+		void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const override;
+
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> Params() override;
+		void ParamsChanged() override;
 
 		std::istream& Read(std::istream& istr) override;
 		std::ostream& Write(std::ostream& ostr) const override;
+
+		void ReadBinary(BinaryReader& reader) override;
+		void WriteBinary(BinaryWriter& writer) const override;
 	};
+
+	typedef BasicConvL<double> ConvL;
+	typedef BasicConvL<float> ConvLf;
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "conv_tuner.h"
+#include "fft.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace NNet {
+	///Samples per benchmarked batch and minimal measuring time per engine
+	const int TUNE_BATCH = 8;
+	const double TUNE_SECONDS = 0.05;
+
+	///Constant-initialized, so it is usable before dynamic initialization runs
+	static std::atomic<bool> autotune{ true };
+
+	///Tuning results keyed by CPU and shape, loaded from the tuning file on first use
+	///mtx guards them together with the file name, but is never held during a benchmark
+	struct TunerState {
+		std::string tuning_file;
+		std::map<std::string, ConvAlgo> results;
+		std::string loaded_file;
+		bool loaded = false;
+		std::mutex mtx;
+	};
+
+	///Built on first use, so nets defined at namespace scope in other translation units can't see it unconstructed
+	static TunerState& State() {
+		static TunerState state;
+		return state;
+	}
+
+	void SetConvAutotune(bool enabled) { autotune = enabled; }
+	bool ConvAutotune() { return autotune; }
+
+	void SetConvTuningFile(const std::string& path) {
+		TunerState& state = State();
+		std::lock_guard<std::mutex> lock(state.mtx);
+		state.tuning_file = path;
+	}
+	std::string ConvTuningFile() {
+		TunerState& state = State();
+		std::lock_guard<std::mutex> lock(state.mtx);
+		return state.tuning_file;
+	}
+
+	///Processor brand string with the thread counts, spaces replaced so that it reads as one token
+	static std::string CPUKey() {
+		std::string name;
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 0x80000000);
+		if ((unsigned)regs[0] >= 0x80000004) {
+			for (int leaf = 0x80000002; leaf <= 0x80000004; leaf++) {
+				__cpuid(regs, leaf);
+				name.append(reinterpret_cast<const char*>(regs), sizeof(regs));
+			}
+		}
+#elif defined(__x86_64__) || defined(__i386__)
+		unsigned regs[4];
+		if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+			for (unsigned leaf = 0x80000002; leaf <= 0x80000004; leaf++) {
+				__get_cpuid(leaf, &regs[0], &regs[1], &regs[2], &regs[3]);
+				name.append(reinterpret_cast<const char*>(regs), sizeof(regs));
+			}
+		}
+#endif
+		name = name.c_str();
+		if (name.find_first_not_of(' ') == std::string::npos) name = "unknown";
+
+		std::ostringstream key;
+		for (char c : name.substr(name.find_first_not_of(' '))) key << (c == ' ' ? '_' : c);
+		key << "/" << std::thread::hardware_concurrency() << "t/fft" << FFTThreads();
+		return key.str();
+	}
+
+	static std::string ShapeKey(const ConvShape& shape) {
+		std::ostringstream key;
+		key << shape.in_d << ' ' << shape.in_h << ' ' << shape.in_w << ' '
+			<< shape.kernel_d << ' ' << shape.kernel_h << ' ' << shape.kernel_w << ' '
+			<< shape.out_h << ' ' << shape.out_w << ' ' << shape.off_h << ' ' << shape.off_w;
+		return key.str();
+	}
+
+	///Every line of the tuning file is "<cpu key>/<scalar type> <10 shape values> <algorithm>"
+	///state.mtx has to be held
+	static void LoadResults(TunerState& state) {
+		if (state.loaded && state.loaded_file == state.tuning_file) return;
+		state.results.clear();
+		state.loaded = true;
+		state.loaded_file = state.tuning_file;
+		if (state.tuning_file.empty()) return;
+
+		std::ifstream istr{ state.tuning_file };
+		std::string line;
+		while (std::getline(istr, line)) {
+			std::istringstream ls{ line };
+			std::string cpu;
+			ConvShape shape;
+			int algo;
+			if (ls >> cpu >> shape.in_d >> shape.in_h >> shape.in_w >> shape.kernel_d >> shape.kernel_h >> shape.kernel_w
+				>> shape.out_h >> shape.out_w >> shape.off_h >> shape.off_w >> algo && algo > CONV_AUTO && algo <= CONV_WINOGRAD) {
+				state.results[cpu + ' ' + ShapeKey(shape)] = (ConvAlgo)algo;
+			}
+		}
+	}
+
+	///Seconds per forward + backward pass of a batch, the best of as many runs as fit in TUNE_SECONDS
+	template <typename T> static double Benchmark(ConvAlgo algo, const ConvShape& shape) {
+		std::unique_ptr<ConvEngine<T>> engine{ MakeConvEngine<T>(algo, shape) };
+
+		BasicTensor<T> kernels(shape.kernel_d, shape.kernel_h, shape.kernel_w), kernel_grads = kernels;
+		Eigen::Map<Eigen::VectorX<T>>(kernels.Data(), shape.kernel_d * shape.kernel_h * shape.kernel_w).setRandom();
+		kernel_grads.SetZero();
+
+		Eigen::MatrixX<T> in = Eigen::MatrixX<T>::Random(shape.in_d * shape.in_h * shape.in_w, TUNE_BATCH);
+		Eigen::MatrixX<T> out(shape.in_d * shape.kernel_d * shape.out_h * shape.out_w, TUNE_BATCH);
+		Eigen::MatrixX<T> in_grads = Eigen::MatrixX<T>::Zero(in.rows(), TUNE_BATCH);
+
+		double best = 1e300, total = 0;
+		for (int run = 0; run < 3 || total < TUNE_SECONDS; run++) {
+			auto start = std::chrono::steady_clock::now();
+			engine->Forward(in, kernels, out);
+			engine->Backward(out, in, kernels, in_grads, kernel_grads);
+			engine->KernelsChanged();
+			double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// the first run only warms up caches and FFT plans
+			if (run) best = std::min(best, t);
+			total += t;
+		}
+		return best;
+	}
+
+	template <typename T> ConvAlgo TunedConvAlgo(const ConvShape& shape) {
+		if (!autotune) return CONV_AUTO;
+
+		TunerState& state = State();
+		std::string key = CPUKey() + '/' + ScalarName<T>() + ' ' + ShapeKey(shape);
+		{
+			std::lock_guard<std::mutex> lock(state.mtx);
+			LoadResults(state);
+			auto it = state.results.find(key);
+			if (it != state.results.end()) return it->second;
+		}
+
+		// other threads keep building and loading nets meanwhile, two of them may end up measuring the same shape
+		std::vector<ConvAlgo> candidates{ CONV_FFT, CONV_DIRECT, CONV_IM2COL };
+		if (shape.kernel_h == 3 && shape.kernel_w == 3) candidates.push_back(CONV_WINOGRAD);
+
+		// an engine that can't handle the shape is left out, it must not take the net that is being tuned down with it
+		ConvAlgo best = CONV_AUTO;
+		double best_time = 0;
+		for (ConvAlgo algo : candidates) {
+			double t;
+			try { t = Benchmark<T>(algo, shape); }
+			catch (...) { continue; }
+			if (best == CONV_AUTO || t < best_time) { best = algo; best_time = t; }
+		}
+		// no engine handles the shape, the layer keeps its default engine and reports the problem itself
+		if (best == CONV_AUTO) return CONV_AUTO;
+
+		std::lock_guard<std::mutex> lock(state.mtx);
+		LoadResults(state);
+		// the result that was stored first wins, so all layers of a shape agree and the file gets one line per shape
+		auto inserted = state.results.emplace(key, best);
+		if (!inserted.second) return inserted.first->second;
+		if (!state.tuning_file.empty()) {
+			std::ofstream ostr{ state.tuning_file, std::ios::app };
+			ostr << key << ' ' << best << '\n';
+		}
+		return best;
+	}
+
+	template <typename T> ConvAlgo CachedConvAlgo(const ConvShape& shape) {
+		if (!autotune) return CONV_AUTO;
+
+		TunerState& state = State();
+		std::string key = CPUKey() + '/' + ScalarName<T>() + ' ' + ShapeKey(shape);
+		std::lock_guard<std::mutex> lock(state.mtx);
+		LoadResults(state);
+		auto it = state.results.find(key);
+		return it != state.results.end() ? it->second : CONV_AUTO;
+	}
+
+	template ConvAlgo TunedConvAlgo<float>(const ConvShape&);
+	template ConvAlgo TunedConvAlgo<double>(const ConvShape&);
+	template ConvAlgo CachedConvAlgo<float>(const ConvShape&);
+	template ConvAlgo CachedConvAlgo<double>(const ConvShape&);
+}
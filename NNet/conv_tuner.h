@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include "conv_engine.h"
+
+namespace NNet {
+	///Measured choice of convolution engine for ConvL layers left on CONV_AUTO
+	///without a tuning file every shape is benchmarked once per process; programs that build nets repeatedly should set one
+	///(Server serve --tuning-file, the Tester programs do), winners are then appended to it and read back so each shape is measured once per CPU
+	
+	///Enables autotuning of ConvL layers on their first forward pass or through NeuralNet::Autotune (on by default)
+	void SetConvAutotune(bool enabled);
+	bool ConvAutotune();
+
+	///Tuning file, an empty path keeps results in memory only (the default, so building a net never creates files)
+	void SetConvTuningFile(const std::string& path);
+	std::string ConvTuningFile();
+
+	///Fastest engine of scalar type T for the given shape on this CPU, benchmarks all applicable engines if the shape is not known yet
+	///thread-safe, the benchmark runs without holding any lock; engines that throw for the shape are skipped
+	///returns CONV_AUTO if autotuning is disabled or no engine handles the shape
+	template <typename T> ConvAlgo TunedConvAlgo(const ConvShape& shape);
+	///Result of an earlier TunedConvAlgo for the shape (this process or the tuning file), CONV_AUTO if there is none
+	///never benchmarks or writes, for loaders that have to start in constant time
+	template <typename T> ConvAlgo CachedConvAlgo(const ConvShape& shape);
+}
@@ -0,0 +1,196 @@
+#include "pch.h"
+#include "cross_conv_layer.h"
+
+namespace NNet {
+	template <typename T> void BasicCrossConvL<T>::CalcOutSizes() {
+		if (pad == SAME) { out_h = in_h; out_w = in_w; }
+		else if (pad == VALID) { out_h = in_h - kernel_h + 1; out_w = in_w - kernel_w + 1; }
+	}
+
+	template <typename T> BasicCrossConvL<T>::BasicCrossConvL(T lrate_, int input_h, int input_w, int output_d, int kernel_h, int kernel_w, Padding pad) :
+		in_h(input_h), in_w(input_w), out_d(output_d), kernel_h(kernel_h), kernel_w(kernel_w), pad(pad)
+	{
+		lrate = lrate_;
+		id = "CrossConv";
+	}
+	template <typename T> BasicCrossConvL<T>::BasicCrossConvL(const BasicCrossConvL& other) {
+		in_d = other.InDepth();
+		in_h = other.InHeight();
+		in_w = other.InWidth();
+		out_d = other.OutDepth();
+
+		kernels = other.Kernels();
+		kernel_h = kernels.Height();
+		kernel_w = kernels.Width();
+
+		lrate = other.LRate();
+		pad = other.GetPadding();
+
+		CalcOutSizes();
+
+		id = "CrossConv";
+	}
+	template <typename T> BasicCrossConvL<T>::BasicCrossConvL(std::istream& istr) {
+		id = "CrossConv";
+		Read(istr);
+	}
+	template <typename T> BasicCrossConvL<T>::BasicCrossConvL(BinaryReader& reader) {
+		id = "CrossConv";
+		ReadBinary(reader);
+	}
+
+	template <typename T> int BasicCrossConvL<T>::InDepth() const { return in_d; }
+	template <typename T> int BasicCrossConvL<T>::InHeight() const { return in_h; }
+	template <typename T> int BasicCrossConvL<T>::InWidth() const { return in_w; }
+	template <typename T> int BasicCrossConvL<T>::OutDepth() const { return out_d; }
+
+	template <typename T> Padding BasicCrossConvL<T>::GetPadding() const { return pad; }
+	template <typename T> BasicTensor<T> BasicCrossConvL<T>::Kernels() const { return kernels; }
+
+	template <typename T> ConvShape BasicCrossConvL<T>::Shape() const {
+		return MakeConvShape(in_d, in_h, in_w, out_d, kernel_h, kernel_w, out_h, out_w, pad);
+	}
+
+	template <typename T> void BasicCrossConvL<T>::SetInputSize(int in_sz) {
+		if (in_sz % (in_h * in_w)) throw Exception("CrossConvL::SetInputSize: Make sure total input size is divisible by the product of input height and width!");
+		in_d = in_sz / (in_h * in_w);
+		CalcOutSizes();
+	}
+	template <typename T> void BasicCrossConvL<T>::InitParams(d_F GenFunc) {
+		kernels = BasicTensor<T>(out_d * in_d, kernel_h, kernel_w);
+		for (int i = 0; i < out_d * in_d; i++) {
+			for (int j = 0; j < kernel_h; j++) {
+				for (int k = 0; k < kernel_w; k++) kernels[i](j, k) = GenFunc();
+			}
+		}
+	}
+	template <typename T> int BasicCrossConvL<T>::OutSize() const {
+		return out_d * out_h * out_w;
+	}
+
+	// the patches of all samples sit side by side in cols, so a whole batch is a single
+	// out_d x (in_d * kernel_h * kernel_w) times (in_d * kernel_h * kernel_w) x (area * batch size) GEMM
+
+	template <typename T> void BasicCrossConvL<T>::Forward(const Eigen::MatrixX<T>& in, MatrixRX<T>& cols, Eigen::MatrixX<T>& out) const {
+		ConvShape shape = Shape();
+		int area = out_h * out_w, patch = kernel_h * kernel_w;
+
+		cols.resize(in_d * patch, (std::ptrdiff_t)area * in.cols());
+		for (int s = 0; s < in.cols(); s++) {
+			TensorView<const T> sample(in.col(s).data(), in_d, in_h, in_w);
+			for (int i = 0; i < in_d; i++) Im2col<T>(sample[i], shape, cols.block(i * patch, s * area, patch, area));
+		}
+
+		Eigen::Map<const MatrixRX<T>> ker(kernels.Data(), out_d, in_d * patch);
+		MatrixRX<T> res = ker * cols;
+
+		out.resize(OutSize(), in.cols());
+		for (int s = 0; s < in.cols(); s++) {
+			for (int o = 0; o < out_d; o++) out.col(s).segment(o * area, area) = res.row(o).segment(s * area, area).transpose();
+		}
+	}
+
+	template <typename T> Eigen::MatrixX<T> BasicCrossConvL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_d * in_h * in_w) throw Exception("CrossConvL::ForwardBatch: Input size doesn't match!");
+
+		Eigen::MatrixX<T> out;
+		Forward(in, cols, out);
+		return out;
+	}
+	template <typename T> void BasicCrossConvL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const {
+		if (in.rows() != in_d * in_h * in_w) throw Exception("CrossConvL::Infer: Input size doesn't match!");
+		Forward(in, ws.cols, out);
+	}
+	template <typename T> Eigen::MatrixX<T> BasicCrossConvL<T>::BackwardBatch(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != out_d * out_h * out_w) throw Exception("CrossConvL::BackwardBatch: Gradient list is not the right size!");
+
+		int area = out_h * out_w, patch = kernel_h * kernel_w;
+		if (cols.cols() != (std::ptrdiff_t)area * grads.cols()) throw Exception("CrossConvL::BackwardBatch: Batch size doesn't match the previous Forward!");
+
+		MatrixRX<T> g(out_d, (std::ptrdiff_t)area * grads.cols());
+		for (int s = 0; s < grads.cols(); s++) {
+			for (int o = 0; o < out_d; o++) g.row(o).segment(s * area, area) = grads.col(s).segment(o * area, area).transpose();
+		}
+
+		Eigen::Map<MatrixRX<T>> ker(kernels.Data(), out_d, in_d * patch);
+		MatrixRX<T> dcols = ker.transpose() * g;
+		ker -= (lrate / grads.cols()) * g * cols.transpose();
+
+		ConvShape shape = Shape();
+		Eigen::MatrixX<T> out = Eigen::MatrixX<T>::Zero(in_d * in_h * in_w, grads.cols());
+		for (int s = 0; s < grads.cols(); s++) {
+			TensorView<T> sample(out.col(s).data(), in_d, in_h, in_w);
+			for (int i = 0; i < in_d; i++) Col2im<T>(dcols.block(i * patch, s * area, patch, area), shape, sample[i]);
+		}
+
+		return out;
+	}
+
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicCrossConvL<T>::Params() {
+		return { Eigen::Map<Eigen::VectorX<T>>(kernels.Data(), kernels.Flat().size()) };
+	}
+
+	template <typename T> std::istream& BasicCrossConvL<T>::Read(std::istream& istr) {
+		istr >> in_d >> in_h >> in_w >> out_d >> kernel_h >> kernel_w;
+		int a;
+		istr >> a;
+		if (a < 0 || a >= 2) throw Exception("CrossConvL::Read: Invalid data given to read from stream!");
+		pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("CrossConvL::Read: Input and kernel sizes in the data don't fit together!");
+		istr >> lrate;
+
+		CalcOutSizes();
+		cols.resize(0, 0);
+
+		kernels = BasicTensor<T>(out_d * in_d, kernel_h, kernel_w);
+		for (int i = 0; i < out_d * in_d; i++) {
+			for (int j = 0; j < kernel_h; j++) {
+				for (int k = 0; k < kernel_w; k++) istr >> kernels[i](j, k);
+			}
+		}
+
+		return istr;
+	}
+
+	template <typename T> std::ostream& BasicCrossConvL<T>::Write(std::ostream& ostr) const {
+		ostr << id << '\n';
+		ostr << in_d << ' ' << in_h << ' ' << in_w << '\n' << out_d << ' ' << kernel_h << ' ' << kernel_w << '\n' << pad << '\n' << lrate << '\n';
+
+		for (int i = 0; i < out_d * in_d; i++) ostr << kernels[i] << '\n';
+
+		return ostr;
+	}
+
+	template <typename T> void BasicCrossConvL<T>::ReadBinary(BinaryReader& reader) {
+		in_d = reader.GetSize();
+		in_h = reader.GetSize();
+		in_w = reader.GetSize();
+		out_d = reader.GetSize();
+		kernel_h = reader.GetSize();
+		kernel_w = reader.GetSize();
+		int a = reader.Get<int32_t>();
+		if (a < 0 || a >= 2) throw Exception("CrossConvL::ReadBinary: Invalid data given to read from!");
+		pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("CrossConvL::ReadBinary: Input and kernel sizes in the data don't fit together!");
+		lrate = (T)reader.Get<double>();
+		reader.BlobSize({ out_d, in_d, kernel_h, kernel_w });
+
+		CalcOutSizes();
+		cols.resize(0, 0);
+
+		kernels = BasicTensor<T>(out_d * in_d, kernel_h, kernel_w);
+		reader.GetBlob(kernels.Data(), kernels.Flat().size());
+	}
+	template <typename T> void BasicCrossConvL<T>::WriteBinary(BinaryWriter& writer) const {
+		for (int v : { in_d, in_h, in_w, out_d, kernel_h, kernel_w, (int)pad }) writer.Put<int32_t>(v);
+		writer.Put<double>(lrate);
+		writer.PutBlob(kernels.Data(), kernels.Flat().size());
+	}
+
+	template class BasicCrossConvL<float>;
+	template class BasicCrossConvL<double>;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "layer.h"
+#include "helpers.h"
+#include "conv_engine.h"
+
+namespace NNet {
+	///Convolution layer that sums over input channels, as in standard CNNs
+	///each of the out_d output channels has its own in_d x kernel_h x kernel_w kernel, so the output depth
+	///is chosen by the user instead of growing with in_d as in ConvL
+	template <typename T> class BasicCrossConvL : public LayerCRTP<BasicCrossConvL<T>, T> {
+	private:
+		using BasicLayer<T>::lrate;
+		using BasicLayer<T>::id;
+
+		int in_d, in_h, in_w;
+		int out_d, out_h, out_w;
+		int kernel_h, kernel_w;
+		Padding pad;
+		///Kernel of output channel o over input channel i is channel o * in_d + i
+		BasicTensor<T> kernels;
+
+		///Patch matrix of the last batch, (in_d * kernel_h * kernel_w) x (out_h * out_w * batch size)
+		MatrixRX<T> cols;
+
+		void CalcOutSizes();
+		///Forward pass through the given patch matrix, shared by ForwardBatch and Infer
+		void Forward(const Eigen::MatrixX<T>& in, MatrixRX<T>& cols, Eigen::MatrixX<T>& out) const;
+	public:
+		BasicCrossConvL(T lrate, int input_h, int input_w, int output_d, int kernel_h, int kernel_w, Padding pad);
+		BasicCrossConvL(const BasicCrossConvL& other);
+		BasicCrossConvL(std::istream& istr);
+		BasicCrossConvL(BinaryReader& reader);
+
+		int InDepth() const;
+		int InHeight() const;
+		int InWidth() const;
+		int OutDepth() const;
+
+		Padding GetPadding() const;
+		BasicTensor<T> Kernels() const;
+
+		///Spatial geometry shared with ConvL, kernel_d is the output depth
+		ConvShape Shape() const;
+
+		void SetInputSize(int in_sz) override;
+		void InitParams(d_F GenFunc) override;
+		int OutSize() const override;
+
+		Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>& in) override;
+		Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>& grads) override;
+		void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const override;
+
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> Params() override;
+
+		std::istream& Read(std::istream& istr) override;
+		std::ostream& Write(std::ostream& ostr) const override;
+
+		void ReadBinary(BinaryReader& reader) override;
+		void WriteBinary(BinaryWriter& writer) const override;
+	};
+
+	typedef BasicCrossConvL<double> CrossConvL;
+	typedef BasicCrossConvL<float> CrossConvLf;
+}
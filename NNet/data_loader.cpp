@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "data_loader.h"
+#include "errors.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace NNet {
+	template <typename T> BasicDataLoader<T>::BasicDataLoader(const Dataset& data, const LoaderOptions& options) :
+		data(data), opt(options), stop(false), failing(false), failed(false), next(0), stall(0)
+	{
+		if (opt.indices.empty()) {
+			if (opt.count < 0) opt.count = data.Size() - opt.first;
+			if (opt.first < 0 || opt.count <= 0 || opt.first > data.Size() - opt.count) throw Exception("DataLoader::DataLoader: Sample range is out of the dataset!");
+			samples.resize(opt.count);
+			std::iota(samples.begin(), samples.end(), opt.first);
+		}
+		else {
+			for (int i : opt.indices) {
+				if (i < 0 || i >= data.Size()) throw Exception("DataLoader::DataLoader: Sample index is out of the dataset!");
+			}
+			samples = std::move(opt.indices);
+			opt.count = samples.size();
+		}
+		if (opt.batch_size <= 0 || opt.workers <= 0 || opt.prefetch <= 0 || opt.epochs < 0) throw Exception("DataLoader::DataLoader: Batch size, worker count and prefetch depth must be positive!");
+
+		per_epoch = (opt.count + opt.batch_size - 1) / opt.batch_size;
+
+		for (int w = 0; w < opt.workers; w++) queues.emplace_back(new BoundedQueue<Batch>(opt.prefetch));
+		for (int w = 0; w < opt.workers; w++) workers.emplace_back(&BasicDataLoader::Work, this, w);
+	}
+
+	template <typename T> BasicDataLoader<T>::~BasicDataLoader() {
+		stop = true;
+		for (auto& worker : workers) worker.join();
+	}
+
+	template <typename T> int BasicDataLoader<T>::BatchesPerEpoch() const { return per_epoch; }
+	template <typename T> double BasicDataLoader<T>::StallSeconds() const { return stall; }
+
+	template <typename T> std::vector<int> BasicDataLoader<T>::Order(int epoch) const {
+		std::vector<int> order = samples;
+		if (opt.shuffle) {
+			std::seed_seq seq{ opt.seed, (unsigned)epoch };
+			std::mt19937 rng(seq);
+			std::shuffle(order.begin(), order.end(), rng);
+		}
+		return order;
+	}
+
+	template <typename T> void BasicDataLoader<T>::Fill(Batch& batch, const std::vector<int>& order, int first, int n) const {
+		int in_sz = data.InputSize();
+		batch.inputs.resize(in_sz, n);
+		batch.targets = Eigen::MatrixX<T>::Zero(data.Classes(), n);
+
+		for (int k = 0; k < n; k++) {
+			int i = order[first + k];
+			batch.inputs.col(k) = (Eigen::Map<const Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>>(data.Sample(i), in_sz).template cast<T>().array() * T(opt.scale) + T(opt.shift)).matrix();
+
+			int label = data.Label(i);
+			if (label < 0 || label >= data.Classes()) throw Exception("DataLoader::Fill: Label out of range!");
+			batch.targets(label, k) = 1;
+		}
+	}
+
+	template <typename T> void BasicDataLoader<T>::Work(int w) {
+		try {
+			std::vector<int> order;
+			int order_epoch = -1;
+			Backoff backoff;
+
+			long long total = (long long)opt.epochs * per_epoch;
+			for (long long b = w; !stop && (!opt.epochs || b < total); b += opt.workers) {
+				Batch batch;
+				batch.epoch = b / per_epoch;
+				if (batch.epoch != order_epoch) {
+					order = Order(batch.epoch);
+					order_epoch = batch.epoch;
+				}
+
+				int first = (b % per_epoch) * opt.batch_size;
+				Fill(batch, order, first, std::min(opt.batch_size, opt.count - first));
+
+				while (!queues[w]->TryPush(batch)) {
+					if (stop) return;
+					backoff.Wait();
+				}
+				backoff.Reset();
+			}
+		}
+		catch (...) {
+			// only the first failure is kept, later ones must not touch error while Next may be reading it
+			bool expected = false;
+			if (failing.compare_exchange_strong(expected, true)) {
+				error = std::current_exception();
+				failed.store(true, std::memory_order_release);
+			}
+		}
+	}
+
+	template <typename T> bool BasicDataLoader<T>::Next(Batch& batch) {
+		if (opt.epochs && next >= (long long)opt.epochs * per_epoch) return false;
+
+		auto& queue = *queues[next % opt.workers];
+		if (!queue.TryPop(batch)) {
+			auto start = std::chrono::steady_clock::now();
+			Backoff backoff;
+			while (!queue.TryPop(batch)) {
+				if (failed.load(std::memory_order_acquire)) std::rethrow_exception(error);
+				backoff.Wait();
+			}
+			stall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		next++;
+		return true;
+	}
+
+	template class BasicDataLoader<float>;
+	template class BasicDataLoader<double>;
+}
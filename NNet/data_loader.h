@@ -0,0 +1,81 @@
+#pragma once
+
+#include "dataset.h"
+#include "bounded_queue.h"
+#include <Eigen/Dense>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace NNet {
+	struct LoaderOptions {
+		int batch_size = 32;
+		bool shuffle = true;
+		///Sample order of epoch e depends only on seed and e
+		unsigned seed = 0;
+		int workers = 2;
+		///Finished batches each worker may keep ahead of the trainer
+		int prefetch = 4;
+		///Inputs are sample * scale + shift, the default maps [0, 255] to [0, 1]
+		double scale = 1. / 255, shift = 0;
+		///Samples first ... first + count - 1 of the dataset are used, count < 0 takes all from first on
+		int first = 0, count = -1;
+		///Explicit list of samples to use instead of first and count, e.g. a train/test split
+		std::vector<int> indices;
+		///Next returns false after this many epochs, 0 never stops
+		int epochs = 0;
+	};
+
+	///Prepares training batches on worker threads while the trainer works on earlier ones
+	///shuffling, normalization, one-hot targets and batch assembly all happen on the workers; worker w builds
+	///batches w, w + workers, ... into its own BoundedQueue, so batches arrive in the same order for any worker count
+	template <typename T> class BasicDataLoader {
+	public:
+		struct Batch {
+			///One sample per column
+			Eigen::MatrixX<T> inputs, targets;
+			int epoch;
+		};
+	private:
+		const Dataset& data;
+		LoaderOptions opt;
+		int per_epoch;
+		///Samples of one epoch before shuffling
+		std::vector<int> samples;
+
+		std::vector<std::unique_ptr<BoundedQueue<Batch>>> queues;
+		std::vector<std::thread> workers;
+		std::atomic<bool> stop;
+		///The first failing worker claims error through failing, stores its exception and then publishes it through failed
+		///error may only be read after failed was seen set
+		std::atomic<bool> failing, failed;
+		std::exception_ptr error;
+
+		long long next;
+		double stall;
+
+		std::vector<int> Order(int epoch) const;
+		void Fill(Batch& batch, const std::vector<int>& order, int first, int n) const;
+		void Work(int w);
+	public:
+		///data has to outlive the loader
+		BasicDataLoader(const Dataset& data, const LoaderOptions& options = LoaderOptions());
+		BasicDataLoader(const BasicDataLoader&) = delete;
+		BasicDataLoader& operator=(const BasicDataLoader&) = delete;
+		~BasicDataLoader();
+
+		///Batches per epoch, the last one is smaller when the batch size doesn't divide the sample count
+		int BatchesPerEpoch() const;
+
+		///Blocks until the next batch is ready, returns false once all epochs were delivered
+		bool Next(Batch& batch);
+
+		///Seconds Next spent waiting for workers, close to 0 when loading fully overlaps with training
+		double StallSeconds() const;
+	};
+
+	typedef BasicDataLoader<double> DataLoader;
+	typedef BasicDataLoader<float> DataLoaderf;
+}
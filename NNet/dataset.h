@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace NNet {
+	///Labelled samples stored as uint8 values, the source a DataLoader reads from
+	///all methods have to be safe to call from several threads at once
+	class Dataset {
+	public:
+		virtual ~Dataset() = default;
+
+		virtual int Size() const = 0;
+		///Values per sample
+		virtual int InputSize() const = 0;
+		///Labels are in [0, Classes())
+		virtual int Classes() const = 0;
+
+		virtual int Label(int i) const = 0;
+		///InputSize() values of sample i, valid as long as the dataset lives
+		virtual const uint8_t* Sample(int i) const = 0;
+	};
+}
@@ -2,8 +2,8 @@
 #include "dense_layer.h"
 
 namespace NNet {
-	DenseL::DenseL(double lrate_, int out_sz_) { id = "Dense"; lrate = lrate_; out_sz = out_sz_; }
-	DenseL::DenseL(const DenseL& other) {
+	template <typename T> BasicDenseL<T>::BasicDenseL(T lrate_, int out_sz_) { id = "Dense"; lrate = lrate_; out_sz = out_sz_; }
+	template <typename T> BasicDenseL<T>::BasicDenseL(const BasicDenseL& other) {
 		weights = other.Weights();
 
 		lrate = other.LRate();
@@ -12,45 +12,58 @@ namespace NNet {
 
 		id = "Dense";
 	}
-	DenseL::DenseL(std::istream& istr) {
+	template <typename T> BasicDenseL<T>::BasicDenseL(std::istream& istr) {
 		id = "Dense";
 		Read(istr);
 	}
+	template <typename T> BasicDenseL<T>::BasicDenseL(BinaryReader& reader) {
+		id = "Dense";
+		ReadBinary(reader);
+	}
 
-	void DenseL::SetInputSize(int input_sz) {
+	template <typename T> void BasicDenseL<T>::SetInputSize(int input_sz) {
 		in_sz = input_sz;
 	}
 
-	int DenseL::InSize() const { return in_sz; }
-	int DenseL::OutSize() const { return out_sz; }
+	template <typename T> int BasicDenseL<T>::InSize() const { return in_sz; }
+	template <typename T> int BasicDenseL<T>::OutSize() const { return out_sz; }
 
-	void DenseL::InitParams(d_F GenFunc) {
-		weights = Eigen::MatrixXd{ out_sz, in_sz };
+	template <typename T> void BasicDenseL<T>::InitParams(d_F GenFunc) {
+		weights = Eigen::MatrixX<T>{ out_sz, in_sz };
 		for (int i = 0; i < out_sz; i++) {
 			for (int j = 0; j < in_sz; j++) weights(i, j) = GenFunc();
 		}
 	}
 
-	Eigen::MatrixXd DenseL::Weights() const { return weights; }
+	template <typename T> Eigen::MatrixX<T> BasicDenseL<T>::Weights() const { return weights; }
 
-	Eigen::VectorXd DenseL::Forward(const Eigen::VectorXd& in) {
-		if (in.size() != in_sz) throw Exception("DenseL::Forward: Input sizes don't match");
+	template <typename T> Eigen::MatrixX<T> BasicDenseL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_sz) throw Exception("DenseL::ForwardBatch: Input sizes don't match");
 		cache = in;
 		return weights * in;
 	}
-	Eigen::VectorXd DenseL::Backward(const Eigen::VectorXd& grads) {
-		if (grads.size() != out_sz) throw Exception("DenseL::Backward: Gradient vector size doesn't match");
-		Eigen::VectorXd ret = weights.transpose() * grads;
+	template <typename T> Eigen::MatrixX<T> BasicDenseL<T>::BackwardBatch(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != out_sz) throw Exception("DenseL::BackwardBatch: Gradient vector size doesn't match");
+		if (grads.cols() != cache.cols()) throw Exception("DenseL::BackwardBatch: Batch size doesn't match the previous Forward!");
+		Eigen::MatrixX<T> ret = weights.transpose() * grads;
 
-		for (int i = 0; i < in_sz; i++) weights.col(i) -= lrate * cache(i) * grads;
+		weights.noalias() -= (lrate / grads.cols()) * grads * cache.transpose();
 
 		return ret;
 	}
+	template <typename T> void BasicDenseL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>&) const {
+		if (in.rows() != in_sz) throw Exception("DenseL::Infer: Input sizes don't match");
+		out.noalias() = weights * in;
+	}
+
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicDenseL<T>::Params() {
+		return { Eigen::Map<Eigen::VectorX<T>>(weights.data(), weights.size()) };
+	}
 
-	std::istream& DenseL::Read(std::istream& istr) {
+	template <typename T> std::istream& BasicDenseL<T>::Read(std::istream& istr) {
 		istr >> in_sz >> out_sz >> lrate;
 
-		weights = Eigen::MatrixXd{out_sz, in_sz};
+		weights = Eigen::MatrixX<T>{out_sz, in_sz};
 		for (int i = 0; i < out_sz; i++) {
 			for (int j = 0; j < in_sz; j++) istr >> weights(i, j);
 		}
@@ -58,8 +71,27 @@ namespace NNet {
 		return istr;
 	}
 
-	std::ostream& DenseL::Write(std::ostream& ostr) const {
+	template <typename T> std::ostream& BasicDenseL<T>::Write(std::ostream& ostr) const {
 		ostr << id << '\n' << in_sz << ' ' << out_sz << ' ' << lrate << '\n' << weights << '\n';
 		return ostr;
 	}
+
+	template <typename T> void BasicDenseL<T>::ReadBinary(BinaryReader& reader) {
+		in_sz = reader.GetSize();
+		out_sz = reader.GetSize();
+		lrate = (T)reader.Get<double>();
+		reader.BlobSize({ out_sz, in_sz });
+
+		weights = Eigen::MatrixX<T>{ out_sz, in_sz };
+		reader.GetBlob(weights.data(), weights.size());
+	}
+	template <typename T> void BasicDenseL<T>::WriteBinary(BinaryWriter& writer) const {
+		writer.Put<int32_t>(in_sz);
+		writer.Put<int32_t>(out_sz);
+		writer.Put<double>(lrate);
+		writer.PutBlob(weights.data(), weights.size());
+	}
+
+	template class BasicDenseL<float>;
+	template class BasicDenseL<double>;
 }
\ No newline at end of file
@@ -4,15 +4,21 @@
 #include "layer.h"
 
 namespace NNet {
-	class DenseL : public LayerCRTP<DenseL> {
+	template <typename T> class BasicDenseL : public LayerCRTP<BasicDenseL<T>, T> {
 	private:
-		Eigen::VectorXd cache;
-		Eigen::MatrixXd weights;
+		using BasicLayer<T>::lrate;
+		using BasicLayer<T>::in_sz;
+		using BasicLayer<T>::out_sz;
+		using BasicLayer<T>::id;
+
+		Eigen::MatrixX<T> cache;
+		Eigen::MatrixX<T> weights;
 	public:
-		DenseL(double lrate_, int out_sz);
-		DenseL(const DenseL& other);
-		DenseL(std::istream& istr);
-		~DenseL() = default;
+		BasicDenseL(T lrate_, int out_sz);
+		BasicDenseL(const BasicDenseL& other);
+		BasicDenseL(std::istream& istr);
+		BasicDenseL(BinaryReader& reader);
+		~BasicDenseL() = default;
 
 		void InitParams(d_F GenFunc) override;
 		void SetInputSize(int input_sz) override;
@@ -20,12 +26,21 @@ namespace NNet {
 		int InSize() const;
 		int OutSize() const override;
 
-		Eigen::MatrixXd Weights() const;
+		Eigen::MatrixX<T> Weights() const;
+
+		Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>& in) override;
+		Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>& grads) override;
+		void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const override;
 
-		Eigen::VectorXd Forward(const Eigen::VectorXd& in) override;
-		Eigen::VectorXd Backward(const Eigen::VectorXd& grads) override;
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> Params() override;
 
 		std::istream& Read(std::istream& istr);
 		std::ostream& Write(std::ostream& ostr) const;
+
+		void ReadBinary(BinaryReader& reader) override;
+		void WriteBinary(BinaryWriter& writer) const override;
 	};
+
+	typedef BasicDenseL<double> DenseL;
+	typedef BasicDenseL<float> DenseLf;
 }
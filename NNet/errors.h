@@ -1,13 +1,12 @@
 #pragma once
 
-#include <iostream>
+#include <stdexcept>
 #include <string>
 
 namespace NNet {
-	class Exception {
+	///Error raised by the library, carries its message in what() and leaves reporting to whoever catches it
+	class Exception : public std::runtime_error {
 	public:
-		Exception(const std::string& message) {
-			std::cerr << "Program terminated.\n" << message;
-		}
+		Exception(const std::string& message) : std::runtime_error(message) {}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "fft.h"
+#include "helpers.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace NNet {
+    ///A constant expression, so FFT plans built during static initialization of other translation units get the right twiddles
+    constexpr double PI = 3.14159265358979323846;
+
+    ///2D transforms smaller than this (in elements) always run on the calling thread
+    const double PARALLEL_WORK = 1 << 15;
+
+    std::atomic<int> fft_threads{ 1 };
+
+    void SetFFTThreads(int threads) {
+        if (threads < 1) throw Exception("NNet::SetFFTThreads: At least one thread is needed!");
+        fft_threads = threads;
+    }
+    int FFTThreads() { return fft_threads; }
+
+    ///Calls f(begin, end) on consecutive chunks of [0, cnt), one chunk per FFT thread
+    template <typename F> static void ParallelFor(int cnt, double work, F f) {
+        int threads = std::min(FFTThreads(), cnt);
+        if (threads <= 1 || work < PARALLEL_WORK) {
+            f(0, cnt);
+            return;
+        }
+
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) pool.emplace_back(f, (long long)cnt * t / threads, (long long)cnt * (t + 1) / threads);
+        for (auto& th : pool) th.join();
+    }
+
+    ///std::complex multiplication checks for infinities and NaNs, which is too slow for the butterflies
+    template <typename T> static inline std::complex<T> Mul(const std::complex<T>& a, const std::complex<T>& b) {
+        return { a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() };
+    }
+
+    int NextPow2(int n) {
+        int ret = 1;
+        while (ret < n) ret *= 2;
+        return ret;
+    }
+
+    template <typename T> FFTPlan<T>::FFTPlan(int n) : n(n), rev(n), twiddles(n / 2 + 1) {
+        if (n < 1 || (n & (n - 1))) throw Exception("FFTPlan::FFTPlan: Size must be a power of 2!");
+
+        int logn = 0;
+        while ((1 << logn) < n) logn++;
+
+        rev[0] = 0;
+        for (int k = 1; k < n; k++) rev[k] = (rev[k >> 1] >> 1) | ((k & 1) << (logn - 1));
+
+        // computed in double so that float plans are accurate to the last bit as well
+        for (int k = 0; k <= n / 2; k++) twiddles[k] = std::complex<T>(std::polar(1., 2 * PI * k / n));
+    }
+
+    template <typename T> const FFTPlan<T>& FFTPlan<T>::Get(int n) {
+        static std::map<int, std::unique_ptr<FFTPlan>> plans;
+        static std::mutex mtx;
+        thread_local std::map<int, const FFTPlan*> local;
+
+        auto it = local.find(n);
+        if (it != local.end()) return *it->second;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto& plan = plans[n];
+        if (!plan) {
+            plan.reset(new FFTPlan(n));
+            // the chain of half-size plans is completed before the plan is published, plans in the map already have theirs
+            for (FFTPlan* cur = plan.get(); cur->n >= 2 && !cur->half; ) {
+                auto& next = plans[cur->n / 2];
+                if (!next) next.reset(new FFTPlan(cur->n / 2));
+                cur->half = next.get();
+                cur = next.get();
+            }
+        }
+
+        local[n] = plan.get();
+        return *plan;
+    }
+
+    template <typename T> int FFTPlan<T>::Size() const { return n; }
+
+    template <typename T> void FFTPlan<T>::Transform(std::complex<T>* data, int d, std::ptrdiff_t stride, std::ptrdiff_t lanes) const {
+        for (int k = 0; k < n; k++) {
+            if (k < rev[k]) {
+                for (std::ptrdiff_t l = 0; l < lanes; l++) std::swap(data[k * stride + l], data[rev[k] * stride + l]);
+            }
+        }
+
+        for (int m = 2; m <= n; m *= 2) {
+            int step = n / m, half = m / 2;
+            for (int k = 0; k < n; k += m) {
+                for (int j = 0; j < half; j++) {
+                    std::complex<T> w = (d == -1) ? std::conj(twiddles[j * step]) : twiddles[j * step];
+                    std::complex<T>* a = data + (k + j) * stride;
+                    std::complex<T>* b = data + (k + j + half) * stride;
+
+                    for (std::ptrdiff_t l = 0; l < lanes; l++) {
+                        std::complex<T> t = Mul(w, b[l]);
+                        b[l] = a[l] - t;
+                        a[l] += t;
+                    }
+                }
+            }
+        }
+
+        if (d == -1) {
+            for (int k = 0; k < n; k++) {
+                for (std::ptrdiff_t l = 0; l < lanes; l++) data[k * stride + l] /= n;
+            }
+        }
+    }
+
+    // even and odd samples are packed into one complex sequence z = even + i * odd of half the size,
+    // then Z = E + i * O is split back using the symmetry E[h - k] = conj(E[k]) of real-input spectra
+
+    template <typename T> void FFTPlan<T>::RealForward(const T* in, std::complex<T>* out) const {
+        if (n < 2) throw Exception("FFTPlan::RealForward: Size must be at least 2!");
+        int h = n / 2;
+
+        for (int k = 0; k < h; k++) out[k] = { in[2 * k], in[2 * k + 1] };
+        half->Transform(out, 1);
+
+        for (int k = 0; k <= h / 2; k++) {
+            std::complex<T> a = out[k], b = out[(h - k) % h];
+            std::complex<T> e = (a + std::conj(b)) * T(0.5);
+            std::complex<T> o = (a - std::conj(b)) * std::complex<T>(0, -0.5);
+
+            out[k] = e + Mul(twiddles[k], o);
+            out[h - k] = std::conj(e) + Mul(twiddles[h - k], std::conj(o));
+        }
+    }
+    template <typename T> void FFTPlan<T>::RealInverse(const std::complex<T>* in, T* out) const {
+        if (n < 2) throw Exception("FFTPlan::RealInverse: Size must be at least 2!");
+        int h = n / 2;
+
+        // out holds exactly h complex values, the interleaved layout of z matches the real output
+        std::complex<T>* z = reinterpret_cast<std::complex<T>*>(out);
+        for (int k = 0; k < h; k++) {
+            std::complex<T> e = (in[k] + std::conj(in[h - k])) * T(0.5);
+            std::complex<T> o = Mul(in[k] - std::conj(in[h - k]), std::conj(twiddles[k])) * T(0.5);
+            z[k] = e + Mul(std::complex<T>(0, 1), o);
+        }
+
+        half->Transform(z, -1);
+    }
+
+    template <typename T> Eigen::MatrixX<std::complex<T>> RFFT2(const Eigen::Ref<const MatrixRX<T>>& mat, int rows, int cols) {
+        if (rows < 2 || NextPow2(rows) != rows || NextPow2(cols) != cols) throw Exception("NNet::RFFT2: Padded dimensions must be powers of 2!");
+        if (mat.rows() > rows || mat.cols() > cols) throw Exception("NNet::RFFT2: Matrix is larger than the padded dimensions!");
+
+        Eigen::MatrixX<T> pad = Eigen::MatrixX<T>::Zero(rows, cols);
+        pad.topLeftCorner(mat.rows(), mat.cols()) = mat;
+
+        int h = rows / 2 + 1;
+        Eigen::MatrixX<std::complex<T>> spec(h, cols);
+        const FFTPlan<T>& cplan = FFTPlan<T>::Get(rows);
+        const FFTPlan<T>& rplan = FFTPlan<T>::Get(cols);
+
+        ParallelFor(mat.cols(), (double)rows * cols, [&](int b, int e) {
+            for (int j = b; j < e; j++) cplan.RealForward(pad.col(j).data(), spec.col(j).data());
+        });
+        // columns past the input are all zeros, so are their spectra
+        spec.rightCols(cols - mat.cols()).setZero();
+
+        ParallelFor(h, (double)h * cols, [&](int b, int e) {
+            rplan.Transform(spec.data() + b, 1, h, e - b);
+        });
+
+        return spec;
+    }
+
+    template <typename T> Eigen::MatrixX<T> IRFFT2(Eigen::MatrixX<std::complex<T>> spec, int rows) {
+        int h = rows / 2 + 1, cols = spec.cols();
+        if (rows < 2 || NextPow2(rows) != rows || spec.rows() != h) throw Exception("NNet::IRFFT2: Spectrum doesn't match the given row count!");
+
+        const FFTPlan<T>& cplan = FFTPlan<T>::Get(rows);
+        const FFTPlan<T>& rplan = FFTPlan<T>::Get(cols);
+
+        ParallelFor(h, (double)h * cols, [&](int b, int e) {
+            rplan.Transform(spec.data() + b, -1, h, e - b);
+        });
+
+        Eigen::MatrixX<T> ret(rows, cols);
+        ParallelFor(cols, (double)rows * cols, [&](int b, int e) {
+            for (int j = b; j < e; j++) cplan.RealInverse(spec.col(j).data(), ret.col(j).data());
+        });
+
+        return ret;
+    }
+
+    ///FFT of a vector padded with zeros so that its size is a power of 2
+    ///d = 1 (default) performs FFT, d = -1 performs inverse FFT for vectors whose size is a power of 2
+    Eigen::VectorXcd FFT(const Eigen::VectorXcd& v, int d) {
+        Eigen::VectorXcd r = Eigen::VectorXcd::Zero(NextPow2(v.size()));
+        r.head(v.size()) = v;
+
+        FFTPlan<double>::Get(r.size()).Transform(r.data(), d);
+        return r;
+    }
+
+    ///FFT of a Eigen::MatrixXd padded with zeros so that its dimensions are powers of 2
+    ///d = 1 (default) performs FFT, d = -1 performs inverse FFT for a matrix whose dimensions are powers of 2
+    Eigen::MatrixXcd FFT2(const Eigen::MatrixXcd& mat, int d) {
+        int n = NextPow2(mat.rows()), m = NextPow2(mat.cols());
+
+        Eigen::MatrixXcd r = Eigen::MatrixXcd::Zero(n, m);
+        r.topLeftCorner(mat.rows(), mat.cols()) = mat;
+
+        const FFTPlan<double>& cplan = FFTPlan<double>::Get(n);
+        const FFTPlan<double>& rplan = FFTPlan<double>::Get(m);
+
+        ParallelFor(m, (double)n * m, [&](int b, int e) {
+            for (int j = b; j < e; j++) cplan.Transform(r.col(j).data(), d);
+        });
+        ParallelFor(n, (double)n * m, [&](int b, int e) {
+            rplan.Transform(r.data() + b, d, n, e - b);
+        });
+
+        return r;
+    }
+
+    ///Computes convolution of two matrices using real-input 2D FFTs
+    template <typename T> Eigen::MatrixX<T> Convolve2D(const Eigen::Ref<const MatrixRX<T>>& signal, const Eigen::Ref<const MatrixRX<T>>& mask) {
+        int r = signal.rows() + mask.rows() - 1;
+        int c = signal.cols() + mask.cols() - 1;
+        int n = std::max(2, NextPow2(r)), m = NextPow2(c);
+
+        Eigen::MatrixX<T> res = IRFFT2<T>(RFFT2<T>(signal, n, m).cwiseProduct(RFFT2<T>(mask, n, m)), n);
+        return res.topLeftCorner(r, c);
+    }
+
+    template class FFTPlan<float>;
+    template class FFTPlan<double>;
+
+    template Eigen::MatrixX<std::complex<float>> RFFT2<float>(const Eigen::Ref<const MatrixRXf>&, int, int);
+    template Eigen::MatrixX<std::complex<double>> RFFT2<double>(const Eigen::Ref<const MatrixRXd>&, int, int);
+    template Eigen::MatrixXf IRFFT2<float>(Eigen::MatrixX<std::complex<float>>, int);
+    template Eigen::MatrixXd IRFFT2<double>(Eigen::MatrixX<std::complex<double>>, int);
+    template Eigen::MatrixXf Convolve2D<float>(const Eigen::Ref<const MatrixRXf>&, const Eigen::Ref<const MatrixRXf>&);
+    template Eigen::MatrixXd Convolve2D<double>(const Eigen::Ref<const MatrixRXd>&, const Eigen::Ref<const MatrixRXd>&);
+}
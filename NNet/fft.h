@@ -0,0 +1,52 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "errors.h"
+#include "tensor.h"
+
+namespace NNet {
+    ///Precomputed bit-reversal and twiddle tables for radix-2 FFTs of one size over complex<T>
+    ///plans are immutable once built, so one plan can be shared by any number of threads
+    template <typename T> class FFTPlan {
+    private:
+        int n;
+        std::vector<int> rev;
+        std::vector<std::complex<T>> twiddles;
+        ///Plan of size n / 2 used by RealForward and RealInverse, set by Get so those never look it up
+        const FFTPlan* half = nullptr;
+
+        FFTPlan(int n);
+    public:
+        ///Cached plan for size n (a power of 2), built on first use, thread-safe
+        ///every thread keeps its own index of the plans it used, so only a thread's first request for a size takes the lock
+        static const FFTPlan& Get(int n);
+
+        int Size() const;
+
+        ///In-place transform of `lanes` interleaved sequences: element k of sequence l is data[k * stride + l]
+        ///d = 1 performs FFT, d = -1 performs inverse FFT (scaled by 1/n)
+        void Transform(std::complex<T>* data, int d, std::ptrdiff_t stride = 1, std::ptrdiff_t lanes = 1) const;
+
+        ///Forward FFT of n real values through a complex FFT of half the size, writes the first n / 2 + 1 outputs
+        void RealForward(const T* in, std::complex<T>* out) const;
+        ///Inverse of RealForward, reads n / 2 + 1 values of a Hermitian spectrum and writes n real values
+        void RealInverse(const std::complex<T>* in, T* out) const;
+    };
+
+    ///Number of threads used for row/column passes of large 2D transforms (1 = serial, default)
+    void SetFFTThreads(int threads);
+    int FFTThreads();
+
+    ///Smallest power of 2 that is not less than n
+    int NextPow2(int n);
+
+    ///FFT of a real matrix padded with zeros to rows x cols (powers of 2, rows >= 2)
+    ///the spectrum of a real matrix is Hermitian, so only its first rows / 2 + 1 rows are returned
+    template <typename T> Eigen::MatrixX<std::complex<T>> RFFT2(const Eigen::Ref<const MatrixRX<T>>& mat, int rows, int cols);
+
+    ///Inverse of RFFT2, rows is the padded row count that was passed to it
+    template <typename T> Eigen::MatrixX<T> IRFFT2(Eigen::MatrixX<std::complex<T>> spec, int rows);
+}
@@ -2,7 +2,8 @@
 #include "helpers.h"
 
 namespace NNet {
-    const double PI = acos(-1);
+    template <> const char* ScalarName<float>() { return "float"; }
+    template <> const char* ScalarName<double>() { return "double"; }
 
     double Scale(double val, double mini1, double maxi1, double mini2, double maxi2){
         if (mini1 == maxi1 || mini2 == maxi2) throw Exception("NNet::Scale: Minimum and maximum values must differ!");
@@ -10,81 +11,6 @@ namespace NNet {
         return (val - mini1) * (maxi2 - mini2) / (maxi1 - mini1) + mini2;
     }
 
-    ///FFT of a vector padded with zeros so that its size is a power of 2
-    ///d = 1 (default) performs FFT, d = -1 performs inverse FFT for vectors whose size is a power of 2
-    Eigen::VectorXcd FFT(const Eigen::VectorXcd& v, int d) {
-        int n = 1;
-        while (n < v.size()) n *= 2;
-
-        Eigen::VectorXcd r(n);
-
-        for (int k = 0; k < n; k++) {
-            int b = 0;
-            for (int z = 1; z < n; z *= 2) {
-                b *= 2;
-                if (k & z) b++;
-            }
-            r[b] = (k < v.size()) ? v[k] : 0;
-        }
-
-        for (int m = 2; m <= n; m *= 2) {
-            std::complex<double> wm = exp(std::complex<double>{0, d * 2 * PI / m});
-            for (int k = 0; k < n; k += m) {
-                std::complex<double> w = 1;
-                for (int j = 0; j < m / 2; j++) {
-                    std::complex<double> a = r[k + j], b = w * r[k + j + m / 2];
-                    r[k + j] = a + b;
-                    r[k + j + m / 2] = a - b;
-                    w *= wm;
-                }
-            }
-        }
-
-        if (d == -1) r /= n;
-        return r;
-    }
-
-    ///FFT of a Eigen::MatrixXd padded with zeros so that its dimensions are powers of 2
-    ///d = 1 (default) performs FFT, d = -1 performs inverse FFT for a matrix whose dimensions are powers of 2
-    Eigen::MatrixXcd FFT2(const Eigen::MatrixXcd& mat, int d) {
-        int n = 1;
-        while (n < mat.rows()) n *= 2;
-        int m = 1;
-        while (m < mat.cols()) m *= 2;
-
-        Eigen::MatrixXcd r(n, m);
-        r.fill(0);
-        r.topLeftCorner(mat.rows(), mat.cols()) = mat;
-
-        for (int i = 0; i < n; i++) r.row(i) = FFT(r.row(i), d);
-        for (int i = 0; i < m; i++) r.col(i) = FFT(r.col(i), d);
-
-        return r;
-    }
-
-    ///Computes convolution of two matrices using FFT2 function
-    Eigen::MatrixXd Convolve2D(const Eigen::MatrixXd& signal, const Eigen::MatrixXd& mask) {
-        int r = signal.rows() + mask.rows() - 1;
-        int c = signal.cols() + mask.cols() - 1;
-
-        Eigen::MatrixXd sig(r, c);
-        sig.fill(0);
-        sig.topLeftCorner(signal.rows(), signal.cols()) = signal;
-
-        Eigen::MatrixXd mas(r, c);
-        mas.fill(0);
-        mas.topLeftCorner(mask.rows(), mask.cols()) = mask;
-
-        Eigen::MatrixXcd res = FFT2(FFT2(sig).cwiseProduct(FFT2(mas)), -1);
-        Eigen::MatrixXd ret(r, c);
-
-        for (int i = 0; i < r; i++) {
-            for (int j = 0; j < c; j++) ret(i, j) = res(i, j).real();
-        }
-
-        return ret;
-    }
-
     std::vector<Eigen::MatrixXd> VecTo3D(const Eigen::VectorXd& v, int d, int h, int w) {
         if (v.size() != d * h * w) throw Exception("VecTo3D: given vector doesn't match given dimensions!");
         std::vector<Eigen::MatrixXd> ret;
@@ -109,74 +35,57 @@ namespace NNet {
         return ret;
     }
 
-    Eigen::VectorXd Sigmoid(const Eigen::VectorXd& in) {
-        Eigen::VectorXd ret(in.size());
+    template <typename T> Eigen::VectorX<T> Sigmoid(const Eigen::VectorX<T>& in) {
+        Eigen::VectorX<T> ret(in.size());
 
         for (int i = 0; i < in.size(); i++) ret(i) = 1 / (1 + exp(-in(i)));
 
         return ret;
     }
-    Eigen::MatrixXd SigmoidDeriv(const Eigen::VectorXd& in) {
-        Eigen::VectorXd sigmoid = Sigmoid(in);
-        Eigen::MatrixXd ret(in.size(), in.size());
-
-        for (int i = 0; i < ret.rows(); i++) {
-            for (int j = 0; j < ret.cols(); j++) ret(i, j) = (i == j) ? sigmoid(i) * (1 - sigmoid(i)) : 0;
-        }
+    template <typename T> Eigen::MatrixX<T> SigmoidDeriv(const Eigen::MatrixX<T>& in) {
+        Eigen::ArrayXX<T> sigmoid = (1 + (-in.array()).exp()).inverse();
 
-        return ret;
+        return sigmoid * (1 - sigmoid);
     }
 
-    Eigen::VectorXd Tanh(const Eigen::VectorXd& in) {
-        Eigen::VectorXd ret = in;
+    template <typename T> Eigen::VectorX<T> Tanh(const Eigen::VectorX<T>& in) {
+        Eigen::VectorX<T> ret = in;
         for (auto& e : ret) e = tanh(e);
 
         return ret;
     }
-    Eigen::MatrixXd TanhDeriv(const Eigen::VectorXd& in) {
-        Eigen::VectorXd tanh = Tanh(in);
-        Eigen::MatrixXd ret(in.size(), in.size());
-
-        for (int i = 0; i < ret.rows(); i++) {
-            for (int j = 0; j < ret.cols(); j++) ret(i, j) = (i == j) ? 1 - tanh(i) * tanh(i) : 0;
-
-        }
-
-        return ret;
+    template <typename T> Eigen::MatrixX<T> TanhDeriv(const Eigen::MatrixX<T>& in) {
+        return 1 - in.array().tanh().square();
     }
 
-    Eigen::VectorXd ReLU(const Eigen::VectorXd& in) {
-        Eigen::VectorXd ret = in;
+    template <typename T> Eigen::VectorX<T> ReLU(const Eigen::VectorX<T>& in) {
+        Eigen::VectorX<T> ret = in;
 
-        for (auto& e : ret) e = std::max(0., e);
+        for (auto& e : ret) e = std::max(T(0), e);
 
         return ret;
     }
 
-    Eigen::MatrixXd ReLUDeriv(const Eigen::VectorXd& in) {
-        Eigen::MatrixXd ret(in.size(), in.size());
+    template <typename T> Eigen::MatrixX<T> ReLUDeriv(const Eigen::MatrixX<T>& in) {
+        return (in.array() > 0).template cast<T>();
+    }
 
-        for (int i = 0; i < ret.rows(); i++) {
-            for (int j = 0; j < ret.cols(); j++) ret(i, j) = (i == j) ? (in(i) > 0) : 0;
-        }
+    template <typename T> Eigen::VectorX<T> Softmax(const Eigen::VectorX<T>& in) {
+        Eigen::ArrayX<T> ex = (in.array() - in.maxCoeff()).exp();
 
-        return ret;
+        return ex / ex.sum();
     }
 
-    Eigen::VectorXd Softmax(const Eigen::VectorXd& in) {
-        double sum = 0.;
-        for (auto x : in) sum += exp(x);
+    template <typename T> Eigen::VectorX<T> LogSoftmax(const Eigen::VectorX<T>& in) {
+        T maxi = in.maxCoeff();
 
-        Eigen::VectorXd ret = in;
-        for (auto& x : ret) x = exp(x) / sum;
-
-        return ret;
+        return in.array() - (maxi + log((in.array() - maxi).exp().sum()));
     }
 
-    Eigen::MatrixXd SoftmaxDeriv(const Eigen::VectorXd& in) {
-        Eigen::VectorXd softmax = Softmax(in);
+    template <typename T> Eigen::MatrixX<T> SoftmaxDeriv(const Eigen::VectorX<T>& in) {
+        Eigen::VectorX<T> softmax = Softmax(in);
 
-        Eigen::MatrixXd ret(in.size(), in.size());
+        Eigen::MatrixX<T> ret(in.size(), in.size());
 
         for (int i = 0; i < in.size(); i++) {
             for (int j = 0; j < in.size(); j++) {
@@ -187,20 +96,20 @@ namespace NNet {
         return ret;
     }
 
-    Eigen::VectorXd SqLossDeriv(const Eigen::VectorXd& out, const Eigen::VectorXd& target) {
+    template <typename T> Eigen::VectorX<T> SqLossDeriv(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target) {
         if (out.size() != target.size()) throw Exception("Sq_Loss_Deriv : out and target sizes don't match");
 
-        Eigen::VectorXd ret(out.size());
+        Eigen::VectorX<T> ret(out.size());
         for (int i = 0; i < out.size(); i++) ret(i) = out(i) - target(i);
 
         return ret;
     }
 
-    double SqLoss(const Eigen::VectorXd& out, const Eigen::VectorXd& target)
+    template <typename T> T SqLoss(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target)
     {
         if (out.size() != target.size()) throw Exception("Sq_Loss : out and target sizes don't match");
 
-        double ret = 0;
+        T ret = 0;
         for (int i = 0; i < out.size(); i++) ret += (out(i) - target(i)) * (out(i) - target(i));
 
         return ret;
@@ -214,10 +123,10 @@ namespace NNet {
         return normal(gen);
     }
 
-    double CrossEntropyLoss(const Eigen::VectorXd& out, const Eigen::VectorXd& target) {
+    template <typename T> T CrossEntropyLoss(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target) {
         if (out.size() != target.size()) throw Exception("Cross_Entropy_Loss : out and target sizes don't match");
 
-        double ret = 0.;
+        T ret = 0.;
 
         for (int i = 0; i < out.size(); i++) {
             if (target(i) == 1) ret = -log(out(i));
@@ -226,25 +135,25 @@ namespace NNet {
         return ret;
     }
 
-    Eigen::VectorXd CrossEntropyLossDeriv(const Eigen::VectorXd& out, const Eigen::VectorXd& target) {
+    template <typename T> Eigen::VectorX<T> CrossEntropyLossDeriv(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target) {
         if (out.size() != target.size()) throw Exception("Cross_Entropy_Loss_Deriv : out and target sizes don't match");
 
-        Eigen::VectorXd ret(out.size());
+        Eigen::VectorX<T> ret(out.size());
 
         for (int i = 0; i < out.size(); i++) {
-            ret(i) = target(i) ? -1. / out(i) : 0;
+            ret(i) = target(i) ? T(-1) / out(i) : T(0);
         }
 
         return ret;
     }
 
-    double MaxPool(const Eigen::MatrixXd& mat) {
+    template <typename T> T MaxPool(const Eigen::MatrixX<T>& mat) {
         return mat.maxCoeff();
     }
-    Eigen::MatrixXd MaxPoolDeriv(const Eigen::MatrixXd& mat, double grad) {
-        Eigen::MatrixXd ret = Eigen::MatrixXd::Zero(mat.rows(), mat.cols());
+    template <typename T> Eigen::MatrixX<T> MaxPoolDeriv(const Eigen::MatrixX<T>& mat, T grad) {
+        Eigen::MatrixX<T> ret = Eigen::MatrixX<T>::Zero(mat.rows(), mat.cols());
 
-        double maxi = mat.maxCoeff();
+        T maxi = mat.maxCoeff();
 
         for (int x = 0; x < mat.rows(); x++) {
             for (int y = 0; y < mat.cols(); y++) {
@@ -255,143 +164,167 @@ namespace NNet {
         return ret;
     }
 
-    double AvgPool(const Eigen::MatrixXd& mat) {
+    template <typename T> T AvgPool(const Eigen::MatrixX<T>& mat) {
         return mat.sum() / (mat.rows() * mat.cols());
     }
-    Eigen::MatrixXd AvgPoolDeriv(const Eigen::MatrixXd& mat, double grad) {
-        Eigen::MatrixXd ret{ mat.rows(), mat.cols() };
+    template <typename T> Eigen::MatrixX<T> AvgPoolDeriv(const Eigen::MatrixX<T>& mat, T grad) {
+        Eigen::MatrixX<T> ret{ mat.rows(), mat.cols() };
 
-        ret.fill(grad);
+        ret.fill(grad / (mat.rows() * mat.cols()));
 
         return ret;
     }
 
-    std::vector<vd_F_vd> ActDecode{ nullptr, Sigmoid, Tanh, ReLU, Softmax };
-    std::map<vd_F_vd, int> ActEncode{
-        {nullptr, 0},
-        {Sigmoid, 1},
-        {Tanh, 2},
-        {ReLU, 3},
-        {Softmax, 4}
-    };
-    std::vector<md_F_vd> ActDerivDecode{ nullptr, SigmoidDeriv, TanhDeriv, ReLUDeriv, SoftmaxDeriv };
-    std::map<md_F_vd, int> ActDerivEncode{
-        {nullptr, 0},
-        {SigmoidDeriv, 1},
-        {TanhDeriv, 2},
-        {ReLUDeriv, 3},
-        {SoftmaxDeriv, 4}
-    };
+    ///Serialization ids of the helpers of one scalar type, the id of a function is its index in its table
+    template <typename T> struct FuncTables {
+        std::vector<v_F_v<T>> act{ nullptr, Sigmoid<T>, Tanh<T>, ReLU<T>, Softmax<T> };
+        // elementwise and Jacobian derivatives share ids, an id is used by exactly one of the two tables
+        std::vector<m_F_v<T>> act_deriv{ nullptr, nullptr, nullptr, nullptr, SoftmaxDeriv<T> };
+        std::vector<m_F_m<T>> act_elem_deriv{ nullptr, SigmoidDeriv<T>, TanhDeriv<T>, ReLUDeriv<T>, nullptr };
 
-    std::vector<d_F_vd_vd> LossDecode{ nullptr, SqLoss, CrossEntropyLoss };
-    std::map<d_F_vd_vd, int> LossEncode{
-        {nullptr, 0},
-        {SqLoss, 1},
-        {CrossEntropyLoss, 2}
-    };
-    std::vector<vd_F_vd_vd> LossDerivDecode{ nullptr, SqLossDeriv, CrossEntropyLossDeriv };
-    std::map<vd_F_vd_vd, int> LossDerivEncode{
-        {nullptr, 0},
-        {SqLossDeriv, 1},
-        {CrossEntropyLossDeriv, 2}
-    };
+        std::vector<s_F_v_v<T>> loss{ nullptr, SqLoss<T>, CrossEntropyLoss<T> };
+        std::vector<v_F_v_v<T>> loss_deriv{ nullptr, SqLossDeriv<T>, CrossEntropyLossDeriv<T> };
 
-    std::vector<d_F_md> PoolDecode{ nullptr, MaxPool, AvgPool };
-    std::map<d_F_md, int> PoolEncode{
-        {nullptr, 0},
-        {MaxPool, 1},
-        {AvgPool, 2}
-    };
-    std::vector<md_F_md_d> PoolDerivDecode{ nullptr, MaxPoolDeriv, AvgPoolDeriv };
-    std::map<md_F_md_d, int> PoolDerivEncode{
-        {nullptr, 0},
-        {MaxPoolDeriv, 1},
-        {AvgPoolDeriv, 2}
+        std::vector<s_F_m<T>> pool{ nullptr, MaxPool<T>, AvgPool<T> };
+        std::vector<m_F_m_s<T>> pool_deriv{ nullptr, MaxPoolDeriv<T>, AvgPoolDeriv<T> };
+
+        static const FuncTables& Get() {
+            static const FuncTables tables;
+            return tables;
+        }
     };
 
-    std::istream& operator>>(std::istream& str, vd_F_vd& func)
-    {
+    ///Unknown functions are written as 0, like nullptr
+    template <typename F> static int Encode(const std::vector<F>& table, F func) {
+        if (!func) return 0;
+        auto it = std::find(table.begin(), table.end(), func);
+        return it == table.end() ? 0 : it - table.begin();
+    }
+    template <typename F> static std::istream& Decode(std::istream& str, const std::vector<F>& table, F& func) {
         int id;
         str >> id;
+        if (id < 0 || id >= table.size()) throw Exception("NNet::Decode: Invalid function id!");
 
-        func = ActDecode[id];
+        func = table[id];
 
         return str;
     }
-    std::ostream& operator<<(std::ostream& str, const vd_F_vd& func)
+
+    template <typename T> std::istream& operator>>(std::istream& str, v_F_v<T>& func)
+    {
+        return Decode(str, FuncTables<T>::Get().act, func);
+    }
+    template <typename T> std::ostream& operator<<(std::ostream& str, const v_F_v<T>& func)
     {
-        str << ActEncode[func] << ' ';
+        str << Encode(FuncTables<T>::Get().act, func) << ' ';
         return str;
     }
 
-    std::istream& operator>>(std::istream& str, md_F_vd& func)
+    template <typename T> std::istream& operator>>(std::istream& str, m_F_v<T>& func)
     {
-        int id;
-        str >> id;
-
-        func = ActDerivDecode[id];
-
-        return str;
+        return Decode(str, FuncTables<T>::Get().act_deriv, func);
     }
-    std::ostream& operator<<(std::ostream& str, const md_F_vd& func)
+    template <typename T> std::ostream& operator<<(std::ostream& str, const m_F_v<T>& func)
     {
-        str << ActDerivEncode[func] << ' ';
+        str << Encode(FuncTables<T>::Get().act_deriv, func) << ' ';
         return str;
     }
 
-    std::istream& operator>>(std::istream& str, d_F_vd_vd& func)
+    template <typename T> std::istream& operator>>(std::istream& str, m_F_m<T>& func)
     {
-        int id;
-        str >> id;
-
-        func = LossDecode[id];
-
-        return str;
+        return Decode(str, FuncTables<T>::Get().act_elem_deriv, func);
     }
-    std::ostream& operator<<(std::ostream& str, const d_F_vd_vd& func)
+    template <typename T> std::ostream& operator<<(std::ostream& str, const m_F_m<T>& func)
     {
-        str << LossEncode[func] << ' ';
+        str << Encode(FuncTables<T>::Get().act_elem_deriv, func) << ' ';
         return str;
     }
 
-    std::istream& operator>>(std::istream& str, vd_F_vd_vd& func)
+    template <typename T> std::istream& ReadActDeriv(std::istream& str, m_F_m<T>& elem, m_F_v<T>& jacobian)
     {
+        const FuncTables<T>& tables = FuncTables<T>::Get();
+
         int id;
         str >> id;
+        if (id < 0 || id >= tables.act_deriv.size()) throw Exception("NNet::ReadActDeriv: Invalid activation derivative id!");
 
-        func = LossDerivDecode[id];
+        elem = tables.act_elem_deriv[id];
+        jacobian = tables.act_deriv[id];
 
         return str;
     }
-    std::ostream& operator<<(std::ostream& str, const vd_F_vd_vd& func)
+
+    template <typename T> std::istream& operator>>(std::istream& str, s_F_v_v<T>& func)
     {
-        str << LossDerivEncode[func] << ' ';
+        return Decode(str, FuncTables<T>::Get().loss, func);
+    }
+    template <typename T> std::ostream& operator<<(std::ostream& str, const s_F_v_v<T>& func)
+    {
+        str << Encode(FuncTables<T>::Get().loss, func) << ' ';
         return str;
     }
 
-    std::istream& operator>>(std::istream& str, d_F_md& func) {
-        int id;
-        str >> id;
-
-        func = PoolDecode[id];
-
-        return str;
+    template <typename T> std::istream& operator>>(std::istream& str, v_F_v_v<T>& func)
+    {
+        return Decode(str, FuncTables<T>::Get().loss_deriv, func);
     }
-    std::ostream& operator<<(std::ostream& str, const d_F_md& func) {
-        str << PoolEncode[func] << ' ';
+    template <typename T> std::ostream& operator<<(std::ostream& str, const v_F_v_v<T>& func)
+    {
+        str << Encode(FuncTables<T>::Get().loss_deriv, func) << ' ';
         return str;
     }
 
-    std::istream& operator>>(std::istream& str, md_F_md_d& func) {
-        int id;
-        str >> id;
-
-        func = PoolDerivDecode[id];
-
+    template <typename T> std::istream& operator>>(std::istream& str, s_F_m<T>& func) {
+        return Decode(str, FuncTables<T>::Get().pool, func);
+    }
+    template <typename T> std::ostream& operator<<(std::ostream& str, const s_F_m<T>& func) {
+        str << Encode(FuncTables<T>::Get().pool, func) << ' ';
         return str;
     }
-    std::ostream& operator<<(std::ostream& str, const md_F_md_d& func) {
-        str << PoolDerivEncode[func] << ' ';
+
+    template <typename T> std::istream& operator>>(std::istream& str, m_F_m_s<T>& func) {
+        return Decode(str, FuncTables<T>::Get().pool_deriv, func);
+    }
+    template <typename T> std::ostream& operator<<(std::ostream& str, const m_F_m_s<T>& func) {
+        str << Encode(FuncTables<T>::Get().pool_deriv, func) << ' ';
         return str;
     }
+
+#define NNET_INSTANTIATE_HELPERS(T) \
+    template Eigen::VectorX<T> Sigmoid<T>(const Eigen::VectorX<T>&); \
+    template Eigen::VectorX<T> Tanh<T>(const Eigen::VectorX<T>&); \
+    template Eigen::VectorX<T> ReLU<T>(const Eigen::VectorX<T>&); \
+    template Eigen::VectorX<T> Softmax<T>(const Eigen::VectorX<T>&); \
+    template Eigen::VectorX<T> LogSoftmax<T>(const Eigen::VectorX<T>&); \
+    template Eigen::MatrixX<T> SoftmaxDeriv<T>(const Eigen::VectorX<T>&); \
+    template Eigen::MatrixX<T> SigmoidDeriv<T>(const Eigen::MatrixX<T>&); \
+    template Eigen::MatrixX<T> TanhDeriv<T>(const Eigen::MatrixX<T>&); \
+    template Eigen::MatrixX<T> ReLUDeriv<T>(const Eigen::MatrixX<T>&); \
+    template T SqLoss<T>(const Eigen::VectorX<T>&, const Eigen::VectorX<T>&); \
+    template T CrossEntropyLoss<T>(const Eigen::VectorX<T>&, const Eigen::VectorX<T>&); \
+    template Eigen::VectorX<T> SqLossDeriv<T>(const Eigen::VectorX<T>&, const Eigen::VectorX<T>&); \
+    template Eigen::VectorX<T> CrossEntropyLossDeriv<T>(const Eigen::VectorX<T>&, const Eigen::VectorX<T>&); \
+    template T MaxPool<T>(const Eigen::MatrixX<T>&); \
+    template T AvgPool<T>(const Eigen::MatrixX<T>&); \
+    template Eigen::MatrixX<T> MaxPoolDeriv<T>(const Eigen::MatrixX<T>&, T); \
+    template Eigen::MatrixX<T> AvgPoolDeriv<T>(const Eigen::MatrixX<T>&, T); \
+    template std::istream& operator>> <T>(std::istream&, v_F_v<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const v_F_v<T>&); \
+    template std::istream& operator>> <T>(std::istream&, m_F_v<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const m_F_v<T>&); \
+    template std::istream& operator>> <T>(std::istream&, m_F_m<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const m_F_m<T>&); \
+    template std::istream& ReadActDeriv<T>(std::istream&, m_F_m<T>&, m_F_v<T>&); \
+    template std::istream& operator>> <T>(std::istream&, s_F_v_v<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const s_F_v_v<T>&); \
+    template std::istream& operator>> <T>(std::istream&, v_F_v_v<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const v_F_v_v<T>&); \
+    template std::istream& operator>> <T>(std::istream&, s_F_m<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const s_F_m<T>&); \
+    template std::istream& operator>> <T>(std::istream&, m_F_m_s<T>&); \
+    template std::ostream& operator<< <T>(std::ostream&, const m_F_m_s<T>&);
+
+    NNET_INSTANTIATE_HELPERS(float)
+    NNET_INSTANTIATE_HELPERS(double)
+#undef NNET_INSTANTIATE_HELPERS
 }
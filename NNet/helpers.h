@@ -4,11 +4,16 @@
 #include <map>
 #include <algorithm>
 #include <random>
+#include <string>
 
 #include <Eigen/Dense>
 #include "errors.h"
+#include "tensor.h"
 
 namespace NNet {
+    ///Name of a supported scalar type as recorded by NeuralNet::Save ("float" or "double")
+    template <typename T> const char* ScalarName();
+
     double Scale(double val, double mini1, double maxi1, double mini2, double maxi2);
 
     ///FFT of a vector padded with zeros so that its size is a power of 2
@@ -19,73 +24,103 @@ namespace NNet {
     ///d = 1 (default) performs FFT, d = -1 performs inverse FFT for a matrix whose dimensions are powers of 2
     Eigen::MatrixXcd FFT2(const Eigen::MatrixXcd& mat, int d = 1);
 
-    ///Computes convolution of two matrices using FFT2 function
-    Eigen::MatrixXd Convolve2D(const Eigen::MatrixXd& signal, const Eigen::MatrixXd& mask);
+    ///Computes convolution of two matrices using real-input 2D FFTs (see fft.h)
+    ///takes row-major references so that Tensor channels are passed without copying
+    template <typename T> Eigen::MatrixX<T> Convolve2D(const Eigen::Ref<const MatrixRX<T>>& signal, const Eigen::Ref<const MatrixRX<T>>& mask);
+    inline Eigen::MatrixXd Convolve2D(const Eigen::Ref<const MatrixRXd>& signal, const Eigen::Ref<const MatrixRXd>& mask) {
+        return Convolve2D<double>(signal, mask);
+    }
 
     std::vector<Eigen::MatrixXd> VecTo3D(const Eigen::VectorXd& v, int d, int h, int w);
     Eigen::VectorXd ThreeDToVec(const std::vector<Eigen::MatrixXd>& t);
 
+    ///Parameters are initialized from doubles whatever the scalar type of the layer
     typedef double(*d_F)();
     double DefaultRandom();
 
+    // all helpers below are templates over the scalar type T (float or double); function names deduce T from
+    // the function pointer type they are assigned to, and the old double typedefs name the T = double pointers
+
     // --------------- Act --------------- //
-    typedef Eigen::VectorXd(*vd_F_vd)(const Eigen::VectorXd&);
+    template <typename T> using v_F_v = Eigen::VectorX<T>(*)(const Eigen::VectorX<T>&);
+    typedef v_F_v<double> vd_F_vd;
 
-    Eigen::VectorXd Sigmoid(const Eigen::VectorXd& x);
-    Eigen::VectorXd Tanh(const Eigen::VectorXd& x);
-    Eigen::VectorXd ReLU(const Eigen::VectorXd& x);
-    Eigen::VectorXd Softmax(const Eigen::VectorXd& in);
+    template <typename T> Eigen::VectorX<T> Sigmoid(const Eigen::VectorX<T>& x);
+    template <typename T> Eigen::VectorX<T> Tanh(const Eigen::VectorX<T>& x);
+    template <typename T> Eigen::VectorX<T> ReLU(const Eigen::VectorX<T>& x);
+    template <typename T> Eigen::VectorX<T> Softmax(const Eigen::VectorX<T>& in);
+    ///Logarithm of Softmax computed through a single log-sum-exp, stable for large inputs
+    template <typename T> Eigen::VectorX<T> LogSoftmax(const Eigen::VectorX<T>& in);
 
-    std::istream& operator>>(std::istream& str, vd_F_vd& func);
-    std::ostream& operator<<(std::ostream& str, const vd_F_vd& func);
+    template <typename T> std::istream& operator>>(std::istream& str, v_F_v<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const v_F_v<T>& func);
 
     // --------------- ActDeriv --------------- //
-    typedef Eigen::MatrixXd(*md_F_vd)(const Eigen::VectorXd&);
+    ///Jacobian of a coupled activation, used for activations like Softmax
+    template <typename T> using m_F_v = Eigen::MatrixX<T>(*)(const Eigen::VectorX<T>&);
+    typedef m_F_v<double> md_F_vd;
+
+    template <typename T> Eigen::MatrixX<T> SoftmaxDeriv(const Eigen::VectorX<T>& in);
+
+    template <typename T> std::istream& operator>>(std::istream& str, m_F_v<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const m_F_v<T>& func);
+
+    // --------------- ActElemDeriv --------------- //
+    ///Derivative of an elementwise activation, evaluated for every element of a batch (one sample per column)
+    template <typename T> using m_F_m = Eigen::MatrixX<T>(*)(const Eigen::MatrixX<T>&);
+    typedef m_F_m<double> md_F_md;
+
+    template <typename T> Eigen::MatrixX<T> SigmoidDeriv(const Eigen::MatrixX<T>& x);
+    template <typename T> Eigen::MatrixX<T> TanhDeriv(const Eigen::MatrixX<T>& x);
+    template <typename T> Eigen::MatrixX<T> ReLUDeriv(const Eigen::MatrixX<T>& x);
 
-    Eigen::MatrixXd SigmoidDeriv(const Eigen::VectorXd& x);
-    Eigen::MatrixXd TanhDeriv(const Eigen::VectorXd& x);
-    Eigen::MatrixXd ReLUDeriv(const Eigen::VectorXd& x);
-    Eigen::MatrixXd SoftmaxDeriv(const Eigen::VectorXd& in);
+    template <typename T> std::istream& operator>>(std::istream& str, m_F_m<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const m_F_m<T>& func);
 
-    std::istream& operator>>(std::istream& str, md_F_vd& func);
-    std::ostream& operator<<(std::ostream& str, const md_F_vd& func);
+    ///Both derivative kinds share one id space, reads an id written by either of them
+    ///exactly one of elem and jacobian is set afterwards (both are nullptr for id 0)
+    template <typename T> std::istream& ReadActDeriv(std::istream& str, m_F_m<T>& elem, m_F_v<T>& jacobian);
 
     // --------------- Loss --------------- //
-    typedef double(*d_F_vd_vd)(const Eigen::VectorXd&, const Eigen::VectorXd&);
+    template <typename T> using s_F_v_v = T(*)(const Eigen::VectorX<T>&, const Eigen::VectorX<T>&);
+    typedef s_F_v_v<double> d_F_vd_vd;
 
-    double SqLoss(const Eigen::VectorXd& out, const Eigen::VectorXd& target);
-    double CrossEntropyLoss(const Eigen::VectorXd& out, const Eigen::VectorXd& target);
+    template <typename T> T SqLoss(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target);
+    template <typename T> T CrossEntropyLoss(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target);
 
-    std::istream& operator>>(std::istream& str, d_F_vd_vd& func);
-    std::ostream& operator<<(std::ostream& str, const d_F_vd_vd& func);
+    template <typename T> std::istream& operator>>(std::istream& str, s_F_v_v<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const s_F_v_v<T>& func);
 
     // --------------- LossDeriv --------------- //
-    typedef Eigen::VectorXd(*vd_F_vd_vd)(const Eigen::VectorXd&, const Eigen::VectorXd&);
+    template <typename T> using v_F_v_v = Eigen::VectorX<T>(*)(const Eigen::VectorX<T>&, const Eigen::VectorX<T>&);
+    typedef v_F_v_v<double> vd_F_vd_vd;
 
-    Eigen::VectorXd SqLossDeriv(const Eigen::VectorXd& out, const Eigen::VectorXd& target);
-    Eigen::VectorXd CrossEntropyLossDeriv(const Eigen::VectorXd& out, const Eigen::VectorXd& target);
+    template <typename T> Eigen::VectorX<T> SqLossDeriv(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target);
+    template <typename T> Eigen::VectorX<T> CrossEntropyLossDeriv(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target);
 
-    std::istream& operator>>(std::istream& str, vd_F_vd_vd& func);
-    std::ostream& operator<<(std::ostream& str, const vd_F_vd_vd& func);
+    template <typename T> std::istream& operator>>(std::istream& str, v_F_v_v<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const v_F_v_v<T>& func);
 
     // --------------- Pool --------------- //
-    typedef double(*d_F_md)(const Eigen::MatrixXd&);
+    template <typename T> using s_F_m = T(*)(const Eigen::MatrixX<T>&);
+    typedef s_F_m<double> d_F_md;
 
-    double MaxPool(const Eigen::MatrixXd& mat);
-    double AvgPool(const Eigen::MatrixXd& mat);
+    template <typename T> T MaxPool(const Eigen::MatrixX<T>& mat);
+    template <typename T> T AvgPool(const Eigen::MatrixX<T>& mat);
 
-    std::istream& operator>>(std::istream& str, d_F_md& func);
-    std::ostream& operator<<(std::ostream& str, const d_F_md& func);
+    template <typename T> std::istream& operator>>(std::istream& str, s_F_m<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const s_F_m<T>& func);
 
     // --------------- PoolDeriv --------------- //
 
-    typedef Eigen::MatrixXd(*md_F_md_d)(const Eigen::MatrixXd&, double);
+    template <typename T> using m_F_m_s = Eigen::MatrixX<T>(*)(const Eigen::MatrixX<T>&, T);
+    typedef m_F_m_s<double> md_F_md_d;
 
-    Eigen::MatrixXd MaxPoolDeriv(const Eigen::MatrixXd& mat, double grad);
-    Eigen::MatrixXd AvgPoolDeriv(const Eigen::MatrixXd& mat, double grad);
+    template <typename T> Eigen::MatrixX<T> MaxPoolDeriv(const Eigen::MatrixX<T>& mat, T grad);
+    template <typename T> Eigen::MatrixX<T> AvgPoolDeriv(const Eigen::MatrixX<T>& mat, T grad);
 
-    std::istream& operator>>(std::istream& str, md_F_md_d& func);
-    std::ostream& operator<<(std::ostream& str, const md_F_md_d& func);
+    template <typename T> std::istream& operator>>(std::istream& str, m_F_m_s<T>& func);
+    template <typename T> std::ostream& operator<<(std::ostream& str, const m_F_m_s<T>& func);
 
     // ----------------- END ----------------- //
 
@@ -95,4 +130,4 @@ namespace NNet {
         for (int i = 0; i < v.size(); i++) ret(i) = v[i];
         return ret;
     }
-}
\ No newline at end of file
+}
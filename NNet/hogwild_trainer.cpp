@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "hogwild_trainer.h"
+#include <chrono>
+
+namespace NNet {
+	std::ostream& operator<<(std::ostream& ostr, const HogwildReport& report) {
+		ostr << "threads: " << report.threads << '\n'
+			<< "samples: " << report.samples << " in " << report.batches << " batches, " << report.seconds << " s\n"
+			<< "throughput: " << report.samples_per_second << " samples/s\n"
+			<< "loss: " << report.loss << '\n';
+		return ostr;
+	}
+
+	template <typename T> BasicHogwildTrainer<T>::BasicHogwildTrainer(BasicNeuralNet<T>& net, int threads) : net(net), pool(threads) {
+		size_t total = 0;
+		for (auto& block : net.Params()) {
+			offsets.push_back(total);
+			total += block.size();
+		}
+		shared = std::vector<std::atomic<T>>(total);
+
+		for (int t = 0; t < pool.Size(); t++) replicas.emplace_back(new BasicNeuralNet<T>(net));
+	}
+
+	template <typename T> int BasicHogwildTrainer<T>::Threads() const { return pool.Size(); }
+
+	template <typename T> void BasicHogwildTrainer<T>::Step(int t, BasicNeuralNet<T>& replica, const BatchSource<T>& source, HogwildReport& report) {
+		auto params = replica.Params();
+		std::vector<Eigen::VectorX<T>> before(params.size());
+
+		// the first step starts from the shared state, every later one from what the previous write-back read
+		for (int b = 0; b < params.size(); b++) {
+			const std::atomic<T>* src = shared.data() + offsets[b];
+			for (Eigen::Index i = 0; i < params[b].size(); i++) params[b](i) = src[i].load(std::memory_order_relaxed);
+			before[b] = params[b];
+		}
+
+		Eigen::MatrixX<T> in, target;
+		while (source(t, in, target)) {
+			replica.ParamsChanged();
+
+			report.loss += replica.FitBatch(in, target) * in.cols();
+			report.samples += in.cols();
+			report.batches++;
+
+			// a single pass adds the change made by this step to the shared state and refreshes the replica from it,
+			// so updates of other threads since the last read are kept and picked up by the next step
+			// values this step didn't change (zero gradients, e.g. weights of zero inputs) are never stored
+			for (int b = 0; b < params.size(); b++) {
+				std::atomic<T>* dst = shared.data() + offsets[b];
+				T* cur = params[b].data();
+				T* old = before[b].data();
+				for (Eigen::Index i = 0; i < params[b].size(); i++) {
+					T val = dst[i].load(std::memory_order_relaxed);
+					if (cur[i] != old[i]) {
+						val += cur[i] - old[i];
+						dst[i].store(val, std::memory_order_relaxed);
+					}
+					cur[i] = old[i] = val;
+				}
+			}
+		}
+	}
+
+	template <typename T> HogwildReport BasicHogwildTrainer<T>::Train(const BatchSource<T>& source) {
+		auto params = net.Params();
+		for (int b = 0; b < params.size(); b++) {
+			for (Eigen::Index i = 0; i < params[b].size(); i++) shared[offsets[b] + i].store(params[b](i), std::memory_order_relaxed);
+		}
+
+		std::vector<HogwildReport> reports(pool.Size(), HogwildReport{ 1, 0, 0, 0, 0, 0 });
+		auto start = std::chrono::steady_clock::now();
+		pool.Run(pool.Size(), [&](int t) { Step(t, *replicas[t], source, reports[t]); });
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// ThreadPool::Run returning orders all relaxed stores before these loads
+		for (int b = 0; b < params.size(); b++) {
+			for (Eigen::Index i = 0; i < params[b].size(); i++) params[b](i) = shared[offsets[b] + i].load(std::memory_order_relaxed);
+		}
+		net.ParamsChanged();
+
+		HogwildReport report{ pool.Size(), 0, 0, seconds, 0, 0 };
+		for (auto& r : reports) {
+			report.samples += r.samples;
+			report.batches += r.batches;
+			report.loss += r.loss;
+		}
+		if (report.samples) report.loss /= report.samples;
+		if (seconds > 0) report.samples_per_second = report.samples / seconds;
+		return report;
+	}
+
+	template class BasicHogwildTrainer<float>;
+	template class BasicHogwildTrainer<double>;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "neural_net.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace NNet {
+	///Throughput and loss of one HogwildTrainer::Train call
+	struct HogwildReport {
+		int threads;
+		long long samples, batches;
+		double seconds;
+		double samples_per_second;
+		///Average training loss over all samples of the call
+		double loss;
+	};
+
+	std::ostream& operator<<(std::ostream& ostr, const HogwildReport& report);
+
+	///Fills the next batch of thread t (one sample per column), returns false once the thread has no more data
+	///called from the training threads, only ever with the thread's own t
+	template <typename T> using BatchSource = std::function<bool(int t, Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& target)>;
+
+	///Asynchronous SGD without locks (Hogwild): every thread trains its own replica and adds the change of each step
+	///to one shared parameter copy, which the next step of any thread starts from
+	///shared parameters are read and written with relaxed atomics, so concurrent changes to one value may be lost
+	///and results differ from run to run; in exchange threads never wait on each other
+	template <typename T> class BasicHogwildTrainer {
+	private:
+		BasicNeuralNet<T>& net;
+		ThreadPool pool;
+		std::vector<std::unique_ptr<BasicNeuralNet<T>>> replicas;
+
+		std::vector<std::atomic<T>> shared;
+		///Offset of every parameter block in shared
+		std::vector<size_t> offsets;
+
+		void Step(int t, BasicNeuralNet<T>& replica, const BatchSource<T>& source, HogwildReport& report);
+	public:
+		///threads = 0 uses all hardware threads, net has to outlive the trainer and keep its layers while it lives
+		BasicHogwildTrainer(BasicNeuralNet<T>& net, int threads = 0);
+
+		int Threads() const;
+
+		///Trains on all threads until every one of them ran out of batches, then writes the result into net
+		///net may be changed between calls, it is read again at the start of each one
+		HogwildReport Train(const BatchSource<T>& source);
+	};
+
+	typedef BasicHogwildTrainer<double> HogwildTrainer;
+	typedef BasicHogwildTrainer<float> HogwildTrainerf;
+}
@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "idx_dataset.h"
+#include "errors.h"
+#include <algorithm>
+
+namespace NNet {
+	///IDX data type code of unsigned bytes
+	const uint8_t IDX_UBYTE = 0x08;
+
+	// --------------- IdxFile --------------- //
+
+	IdxFile::IdxFile(const std::string& path) : file(path) {
+		auto bytes = reinterpret_cast<const uint8_t*>(file.Data());
+		size_t size = file.Size();
+
+		// magic: two zero bytes, the data type and the number of dimensions, followed by big-endian int32 dimensions
+		if (size < 4 || bytes[0] || bytes[1]) throw Exception("IdxFile::IdxFile: " + path + " is not an IDX file!");
+		if (bytes[2] != IDX_UBYTE) throw Exception("IdxFile::IdxFile: Only unsigned byte IDX files are supported!");
+		int ndim = bytes[3];
+		if (!ndim || size < 4 + 4 * (size_t)ndim) throw Exception("IdxFile::IdxFile: " + path + " has an invalid header!");
+
+		size_t total = 1;
+		for (int k = 0; k < ndim; k++) {
+			const uint8_t* p = bytes + 4 + 4 * k;
+			uint32_t d = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+			if (d > INT32_MAX) throw Exception("IdxFile::IdxFile: " + path + " has an invalid header!");
+			dims.push_back((int)d);
+			total *= d;
+		}
+		if (size - 4 - 4 * ndim < total) throw Exception("IdxFile::IdxFile: " + path + " is truncated!");
+
+		data = bytes + 4 + 4 * ndim;
+		sample_sz = 1;
+		for (int k = 1; k < ndim; k++) sample_sz *= dims[k];
+	}
+
+	const std::vector<int>& IdxFile::Dims() const { return dims; }
+	int IdxFile::Count() const { return dims[0]; }
+	int IdxFile::SampleSize() const { return sample_sz; }
+
+	const uint8_t* IdxFile::Sample(int i) const {
+		if (i < 0 || i >= dims[0]) throw Exception("IdxFile::Sample: Index out of range!");
+		return data + (size_t)i * sample_sz;
+	}
+
+	// --------------- IdxDataset --------------- //
+
+	IdxDataset::IdxDataset(const std::string& images_path, const std::string& labels_path) : images(images_path), labels(labels_path) {
+		if (images.Dims().size() != 3) throw Exception("IdxDataset::IdxDataset: " + images_path + " is not an idx3 file!");
+		if (labels.Dims().size() != 1) throw Exception("IdxDataset::IdxDataset: " + labels_path + " is not an idx1 file!");
+		if (images.Count() != labels.Count()) throw Exception("IdxDataset::IdxDataset: Image and label counts don't match!");
+
+		// a pass over the labels is cheap compared to the images and gives the number of classes
+		classes = 0;
+		if (labels.Count()) classes = *std::max_element(labels.Sample(0), labels.Sample(0) + labels.Count()) + 1;
+	}
+
+	int IdxDataset::Size() const { return images.Count(); }
+	int IdxDataset::Rows() const { return images.Dims()[1]; }
+	int IdxDataset::Cols() const { return images.Dims()[2]; }
+	int IdxDataset::InputSize() const { return images.SampleSize(); }
+	int IdxDataset::Classes() const { return classes; }
+
+	int IdxDataset::Label(int i) const { return *labels.Sample(i); }
+	const uint8_t* IdxDataset::Sample(int i) const { return images.Sample(i); }
+
+	size_t IdxDataset::Bytes() const { return (size_t)Size() * (InputSize() + 1); }
+
+	typedef Eigen::Map<const Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic>> PixelMap;
+
+	template <typename T> Eigen::VectorX<T> IdxDataset::Input(int i) const {
+		return PixelMap(images.Sample(i), InputSize(), 1).template cast<T>() * T(1. / 255);
+	}
+	template <typename T> Eigen::MatrixX<T> IdxDataset::Inputs(int first, int n) const {
+		if (n < 0 || first < 0 || first > Size() - n) throw Exception("IdxDataset::Inputs: Index out of range!");
+		if (!n) return Eigen::MatrixX<T>(InputSize(), 0);
+		// samples are contiguous, so the whole batch converts in one expression
+		return PixelMap(images.Sample(first), InputSize(), n).template cast<T>() * T(1. / 255);
+	}
+	template <typename T> Eigen::MatrixX<T> IdxDataset::Inputs(const std::vector<int>& idx) const {
+		Eigen::MatrixX<T> ret(InputSize(), idx.size());
+		for (int k = 0; k < idx.size(); k++) ret.col(k) = PixelMap(images.Sample(idx[k]), InputSize(), 1).template cast<T>() * T(1. / 255);
+		return ret;
+	}
+
+	template <typename T> Eigen::MatrixX<T> IdxDataset::Targets(int first, int n) const {
+		if (n < 0 || first < 0 || first > Size() - n) throw Exception("IdxDataset::Targets: Index out of range!");
+		Eigen::MatrixX<T> ret = Eigen::MatrixX<T>::Zero(classes, n);
+		for (int k = 0; k < n; k++) ret(Label(first + k), k) = 1;
+		return ret;
+	}
+	template <typename T> Eigen::MatrixX<T> IdxDataset::Targets(const std::vector<int>& idx) const {
+		Eigen::MatrixX<T> ret = Eigen::MatrixX<T>::Zero(classes, idx.size());
+		for (int k = 0; k < idx.size(); k++) ret(Label(idx[k]), k) = 1;
+		return ret;
+	}
+
+	template Eigen::VectorXf IdxDataset::Input<float>(int) const;
+	template Eigen::VectorXd IdxDataset::Input<double>(int) const;
+	template Eigen::MatrixXf IdxDataset::Inputs<float>(int, int) const;
+	template Eigen::MatrixXd IdxDataset::Inputs<double>(int, int) const;
+	template Eigen::MatrixXf IdxDataset::Inputs<float>(const std::vector<int>&) const;
+	template Eigen::MatrixXd IdxDataset::Inputs<double>(const std::vector<int>&) const;
+	template Eigen::MatrixXf IdxDataset::Targets<float>(int, int) const;
+	template Eigen::MatrixXd IdxDataset::Targets<double>(int, int) const;
+	template Eigen::MatrixXf IdxDataset::Targets<float>(const std::vector<int>&) const;
+	template Eigen::MatrixXd IdxDataset::Targets<double>(const std::vector<int>&) const;
+}
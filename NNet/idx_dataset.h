@@ -0,0 +1,62 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "dataset.h"
+#include <Eigen/Dense>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NNet {
+	///Memory-mapped IDX file (the format of the MNIST dataset), only unsigned byte data is supported
+	///the first dimension counts samples, the remaining ones make up a single sample
+	class IdxFile {
+	private:
+		MappedFile file;
+		std::vector<int> dims;
+		const uint8_t* data;
+		int sample_sz;
+	public:
+		IdxFile(const std::string& path);
+
+		const std::vector<int>& Dims() const;
+		int Count() const;
+		int SampleSize() const;
+
+		///sample_sz bytes of sample i, straight from the mapping
+		const uint8_t* Sample(int i) const;
+	};
+
+	///Images of an idx3 file with the labels of the matching idx1 file
+	///pixels stay uint8 inside the mappings and are scaled from [0, 255] to [0, 1] only when inputs are requested,
+	///an input is the image in row-major order, the layout ThreeDToVec gives a single channel
+	class IdxDataset : public Dataset {
+	private:
+		IdxFile images, labels;
+		int classes;
+	public:
+		IdxDataset(const std::string& images_path, const std::string& labels_path);
+
+		int Size() const override;
+		int Rows() const;
+		int Cols() const;
+		int InputSize() const override;
+		///Largest label + 1
+		int Classes() const override;
+
+		int Label(int i) const override;
+		const uint8_t* Sample(int i) const override;
+
+		///Bytes of sample data in the mappings
+		size_t Bytes() const;
+
+		template <typename T> Eigen::VectorX<T> Input(int i) const;
+		///Samples first ... first + n - 1 as columns of one batch
+		template <typename T> Eigen::MatrixX<T> Inputs(int first, int n) const;
+		template <typename T> Eigen::MatrixX<T> Inputs(const std::vector<int>& idx) const;
+
+		///One-hot targets with Classes() rows, in the same order as the inputs
+		template <typename T> Eigen::MatrixX<T> Targets(int first, int n) const;
+		template <typename T> Eigen::MatrixX<T> Targets(const std::vector<int>& idx) const;
+	};
+}
@@ -2,14 +2,28 @@
 #include "layer.h"
 
 namespace NNet {
-	int Layer::OutSize() const { return out_sz; }
-    std::string Layer::ID() const { return id; }
-	double Layer::LRate() const { return lrate; }
+	template <typename T> int BasicLayer<T>::OutSize() const { return out_sz; }
+    template <typename T> std::string BasicLayer<T>::ID() const { return id; }
+	template <typename T> T BasicLayer<T>::LRate() const { return lrate; }
+
+	template <typename T> Eigen::VectorX<T> BasicLayer<T>::Forward(const Eigen::VectorX<T>& in) { return ForwardBatch(in); }
+	template <typename T> Eigen::VectorX<T> BasicLayer<T>::Backward(const Eigen::VectorX<T>& grads) { return BackwardBatch(grads); }
+
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicLayer<T>::Params() { return {}; }
+	template <typename T> void BasicLayer<T>::ParamsChanged() {}
+
+	template class BasicLayer<float>;
+	template class BasicLayer<double>;
 }
 
-std::istream& operator>>(std::istream& istr, NNet::Layer*& layer) {
+template <typename T> std::istream& operator>>(std::istream& istr, NNet::BasicLayer<T>*& layer) {
 	return layer->Read(istr);
 }
-std::ostream& operator<<(std::ostream& ostr, const NNet::Layer*& layer) {
+template <typename T> std::ostream& operator<<(std::ostream& ostr, const NNet::BasicLayer<T>*& layer) {
 	return layer->Write(ostr);
-}
\ No newline at end of file
+}
+
+template std::istream& operator>> <float>(std::istream&, NNet::BasicLayer<float>*&);
+template std::istream& operator>> <double>(std::istream&, NNet::BasicLayer<double>*&);
+template std::ostream& operator<< <float>(std::ostream&, const NNet::BasicLayer<float>*&);
+template std::ostream& operator<< <double>(std::ostream&, const NNet::BasicLayer<double>*&);
\ No newline at end of file
@@ -1,47 +1,85 @@
 #pragma once
 
 #include "helpers.h"
+#include "binary_io.h"
+#include "conv_engine.h"
 #include <Eigen/Dense>
+#include <memory>
 
 namespace NNet {
-	class Layer {
+	///Scratch state of one layer for Layer::Infer, owned by the caller so that a const layer can serve several threads
+	///each layer only uses the members it needs, buffers are resized on demand and kept between calls
+	template <typename T> struct LayerWorkspace {
+		MatrixRX<T> cols, depth;
+		///Private copy of a ConvL engine, engines keep transformed kernels and scratch buffers of their own
+		std::unique_ptr<ConvEngine<T>> engine;
+		unsigned long long version = 0;
+	};
+
+	///Base of all layers over scalar type T (float or double), Layer is the double variant
+	template <typename T> class BasicLayer {
 	protected:
-		double lrate;
+		T lrate;
 
 		int in_sz, out_sz;
 
 		std::string id;
 	public:
-		virtual ~Layer() = default;
+		typedef T Scalar;
 
-		virtual Layer* Clone() const = 0;
+		virtual ~BasicLayer() = default;
+
+		virtual BasicLayer* Clone() const = 0;
 
         std::string ID() const;
-		double LRate() const;
+		T LRate() const;
 
 		virtual void InitParams(d_F GenFunc) = 0;
 		virtual void SetInputSize(int input_sz) = 0;
 
 		virtual int OutSize() const = 0;
 
-		virtual Eigen::VectorXd Forward(const Eigen::VectorXd&) = 0;
-		virtual Eigen::VectorXd Backward(const Eigen::VectorXd&) = 0;
+		virtual Eigen::VectorX<T> Forward(const Eigen::VectorX<T>&);
+		virtual Eigen::VectorX<T> Backward(const Eigen::VectorX<T>&);
+
+		///Batched passes, one sample per column
+		///parameters are updated once per batch using the gradient averaged over its samples
+		virtual Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>&) = 0;
+		virtual Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>&) = 0;
+
+		///Inference-only forward pass that caches nothing for Backward, out is reused when it already has the right size
+		///thread-safe as long as every thread passes its own workspace and the parameters aren't modified meanwhile
+		virtual void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const = 0;
+
+		///Trainable parameters as flat blocks (none by default), used to copy and combine the parameters of replicas
+		virtual std::vector<Eigen::Map<Eigen::VectorX<T>>> Params();
+		///Has to be called after parameters were written through Params
+		virtual void ParamsChanged();
 
 		virtual std::istream& Read(std::istream&) = 0;
 		virtual std::ostream& Write(std::ostream&) const = 0;
+
+		///Binary counterparts of Read and Write, parameters are stored as aligned raw blobs
+		virtual void ReadBinary(BinaryReader&) = 0;
+		virtual void WriteBinary(BinaryWriter&) const = 0;
 	};
 
-	template <typename LType> class LayerCRTP : public Layer{
-		Layer* Clone() const override {
+	typedef BasicLayer<double> Layer;
+	typedef BasicLayer<float> Layerf;
+
+	template <typename LType, typename T> class LayerCRTP : public BasicLayer<T> {
+		BasicLayer<T>* Clone() const override {
 			return new LType(static_cast<const LType&>(*this));
 		}
 	};
 }
 
-std::istream& operator>>(std::istream&, NNet::Layer*&);
-std::ostream& operator<<(std::ostream&, const NNet::Layer*&);
+template <typename T> std::istream& operator>>(std::istream&, NNet::BasicLayer<T>*&);
+template <typename T> std::ostream& operator<<(std::ostream&, const NNet::BasicLayer<T>*&);
 
 #include "dense_layer.h"
 #include "act_layer.h"
 #include "conv_layer.h"
+#include "cross_conv_layer.h"
+#include "sep_conv_layer.h"
 #include "pool_layer.h"
\ No newline at end of file
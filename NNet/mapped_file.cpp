@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "mapped_file.h"
+#include "errors.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace NNet {
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) throw Exception("MappedFile::MappedFile: Cannot open " + path + "!");
+
+		LARGE_INTEGER sz;
+		if (!GetFileSizeEx(file, &sz)) { CloseHandle(file); throw Exception("MappedFile::MappedFile: Cannot read the size of " + path + "!"); }
+		size = (size_t)sz.QuadPart;
+		// empty files cannot be mapped, they are represented by a null pointer
+		if (!size) return;
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!data) {
+			if (mapping) CloseHandle(mapping);
+			CloseHandle(file);
+			throw Exception("MappedFile::MappedFile: Cannot map " + path + "!");
+		}
+	}
+	MappedFile::~MappedFile() {
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	}
+#else
+	MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) throw Exception("MappedFile::MappedFile: Cannot open " + path + "!");
+
+		struct stat st;
+		if (fstat(fd, &st)) { close(fd); throw Exception("MappedFile::MappedFile: Cannot read the size of " + path + "!"); }
+		size = (size_t)st.st_size;
+
+		// empty files cannot be mapped, they are represented by a null pointer
+		if (size) {
+			void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			if (ptr == MAP_FAILED) { close(fd); throw Exception("MappedFile::MappedFile: Cannot map " + path + "!"); }
+			data = static_cast<const char*>(ptr);
+		}
+		// the mapping stays valid after the descriptor is closed
+		close(fd);
+	}
+	MappedFile::~MappedFile() {
+		if (data) munmap(const_cast<char*>(data), size);
+	}
+#endif
+
+	const char* MappedFile::Data() const { return data; }
+	size_t MappedFile::Size() const { return size; }
+}
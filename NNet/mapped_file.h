@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace NNet {
+	///Read-only memory mapping of a whole file
+	///pages are loaded on first access and shared through the page cache with every other process mapping the same file
+	class MappedFile {
+	private:
+		const char* data;
+		size_t size;
+#ifdef _WIN32
+		void* file;
+		void* mapping;
+#endif
+	public:
+		MappedFile(const std::string& path);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		const char* Data() const;
+		size_t Size() const;
+	};
+}
@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "mapped_net.h"
+
+namespace NNet {
+	// --------------- MappedDenseL --------------- //
+
+	template <typename T> MappedDenseL<T>::MappedDenseL(BinaryReader& reader) {
+		// same record as DenseL::WriteBinary
+		in_sz = reader.GetSize();
+		out_sz = reader.GetSize();
+		reader.Get<double>();
+		weights = reader.MapBlob<T>(reader.BlobSize({ out_sz, in_sz }));
+	}
+
+	template <typename T> int MappedDenseL<T>::InSize() const { return in_sz; }
+	template <typename T> int MappedDenseL<T>::OutSize() const { return out_sz; }
+
+	template <typename T> void MappedDenseL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out) const {
+		if (in.rows() != in_sz) throw Exception("MappedDenseL::Infer: Input sizes don't match");
+		out.noalias() = Eigen::Map<const Eigen::MatrixX<T>>(weights, out_sz, in_sz) * in;
+	}
+
+	// --------------- MappedConvL --------------- //
+
+	template <typename T> MappedConvL<T>::MappedConvL(BinaryReader& reader) {
+		// same record as ConvL::WriteBinary
+		int in_d = reader.GetSize(), in_h = reader.GetSize(), in_w = reader.GetSize();
+		int kernel_d = reader.GetSize(), kernel_h = reader.GetSize(), kernel_w = reader.GetSize();
+		int a = reader.Get<int32_t>();
+		if (a < 0 || a >= 2) throw Exception("MappedConvL::MappedConvL: Invalid data given to read from!");
+		reader.Get<double>();
+
+		reader.BlobSize({ kernel_d, kernel_h, kernel_w });
+
+		Padding pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("MappedConvL::MappedConvL: Input and kernel sizes in the data don't fit together!");
+		int out_h = pad == SAME ? in_h : in_h - kernel_h + 1, out_w = pad == SAME ? in_w : in_w - kernel_w + 1;
+		shape = MakeConvShape(in_d, in_h, in_w, kernel_d, kernel_h, kernel_w, out_h, out_w, pad);
+
+		kernels = reader.MapBlob<T>((size_t)shape.kernel_d * shape.kernel_h * shape.kernel_w);
+		// only results tuned earlier are used, mapping must not run benchmarks or create files
+		// without one the engine works on the mapped kernels directly, CONV_AUTO could pick FFT and copy them
+		ConvAlgo algo = CachedConvAlgo<T>(shape);
+		engine.reset(MakeConvEngine<T>(algo == CONV_AUTO ? CONV_IM2COL : algo, shape));
+	}
+
+	template <typename T> int MappedConvL<T>::InSize() const { return shape.in_d * shape.in_h * shape.in_w; }
+	template <typename T> int MappedConvL<T>::OutSize() const { return shape.in_d * shape.kernel_d * shape.out_h * shape.out_w; }
+
+	template <typename T> void MappedConvL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const {
+		if (in.rows() != InSize()) throw Exception("MappedConvL::Infer: Input size doesn't match!");
+		if (!ws.engine) ws.engine.reset(engine->Clone());
+
+		out.resize(OutSize(), in.cols());
+		ws.engine->Forward(in, TensorView<const T>(kernels, shape.kernel_d, shape.kernel_h, shape.kernel_w), out);
+	}
+
+	// --------------- MappedNet --------------- //
+
+	template <typename T> BasicMappedNet<T>::BasicMappedNet(const std::string& path, bool verify) : file(path) {
+		BinaryModelInfo info = ReadBinaryModelInfo(file.Data(), file.Size(), verify);
+		if (info.scalar_size != sizeof(T)) throw Exception("MappedNet::MappedNet: " + path + " stores a different scalar type, it can only be loaded through NeuralNet::Load!");
+
+		in_sz = info.in_sz;
+		out_sz = info.out_sz;
+
+		BinaryReader reader{ file.Data(), file.Size(), (int)info.scalar_size };
+		for (auto& entry : info.layers) {
+			reader.Seek(entry.offset);
+			layers.emplace_back();
+			dense.emplace_back();
+			conv.emplace_back();
+
+			if (entry.id == "Dense") dense.back().reset(new MappedDenseL<T>(reader));
+			else if (entry.id == "Conv") conv.back().reset(new MappedConvL<T>(reader));
+			else if (entry.id == "Act") layers.back().reset(new BasicActL<T>(reader));
+			else if (entry.id == "CrossConv") layers.back().reset(new BasicCrossConvL<T>(reader));
+			else if (entry.id == "SepConv") layers.back().reset(new BasicSepConvL<T>(reader));
+			else if (entry.id == "Pool") layers.back().reset(new BasicPoolL<T>(reader));
+			else throw Exception("MappedNet::MappedNet: Unknown layer " + entry.id + " in " + path + "!");
+
+			if (reader.Tell() > entry.offset + entry.size) throw Exception("MappedNet::MappedNet: Layer " + entry.id + " reads past its record!");
+		}
+	}
+
+	template <typename T> int BasicMappedNet<T>::InSize() const { return in_sz; }
+	template <typename T> int BasicMappedNet<T>::OutSize() const { return out_sz; }
+
+	template <typename T> size_t BasicMappedNet<T>::MappedBytes() const { return file.Size(); }
+
+	template <typename T> const Eigen::MatrixX<T>& BasicMappedNet<T>::Infer(const Eigen::MatrixX<T>& in, BasicWorkspace<T>& ws) const {
+		if (in.rows() != in_sz) throw Exception("MappedNet::Infer: Rececived input matrix is not the right size!");
+		if (ws.layers.size() != layers.size()) {
+			ws.layers.clear();
+			ws.layers.resize(layers.size());
+		}
+		if (layers.empty()) return ws.buffers[0] = in;
+
+		// layer i reads the output of layer i - 1 and writes the other buffer
+		const Eigen::MatrixX<T>* cur = &in;
+		for (int i = 0; i < layers.size(); i++) {
+			if (dense[i]) dense[i]->Infer(*cur, ws.buffers[i % 2]);
+			else if (conv[i]) conv[i]->Infer(*cur, ws.buffers[i % 2], ws.layers[i]);
+			else layers[i]->Infer(*cur, ws.buffers[i % 2], ws.layers[i]);
+			cur = &ws.buffers[i % 2];
+		}
+
+		return *cur;
+	}
+
+	template <typename T> Eigen::VectorX<T> BasicMappedNet<T>::Query(const Eigen::VectorX<T>& in) const {
+		if (in.size() != in_sz) throw Exception("MappedNet::Query: Rececived input vector is not the right size!");
+		return QueryBatch(in);
+	}
+	template <typename T> Eigen::MatrixX<T> BasicMappedNet<T>::QueryBatch(const Eigen::MatrixX<T>& in) const {
+		if (in.rows() != in_sz) throw Exception("MappedNet::QueryBatch: Rececived input matrix is not the right size!");
+
+		BasicWorkspace<T> ws;
+		return Infer(in, ws);
+	}
+
+	template class MappedDenseL<float>;
+	template class MappedDenseL<double>;
+	template class MappedConvL<float>;
+	template class MappedConvL<double>;
+	template class BasicMappedNet<float>;
+	template class BasicMappedNet<double>;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "neural_net.h"
+#include "mapped_file.h"
+#include <memory>
+
+namespace NNet {
+	///Inference-only DenseL whose weights live in a mapped binary model file
+	template <typename T> class MappedDenseL {
+	private:
+		int in_sz, out_sz;
+		///out_sz x in_sz column-major matrix inside the mapping
+		const T* weights;
+	public:
+		///reader has to be positioned at a "Dense" record of a mapped image
+		MappedDenseL(BinaryReader& reader);
+
+		int InSize() const;
+		int OutSize() const;
+
+		void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out) const;
+	};
+
+	///Inference-only ConvL whose kernels live in a mapped binary model file
+	template <typename T> class MappedConvL {
+	private:
+		ConvShape shape;
+		const T* kernels;
+		///Engine copied into every workspace, im2col + GEMM unless the shape was tuned earlier
+		///a tuned FFT or Winograd engine keeps transformed kernels of its own, the mapping then isn't the only copy of them
+		std::unique_ptr<ConvEngine<T>> engine;
+	public:
+		///reader has to be positioned at a "Conv" record of a mapped image
+		MappedConvL(BinaryReader& reader);
+
+		int InSize() const;
+		int OutSize() const;
+
+		void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const;
+	};
+
+	///Read-only network served straight from a binary model file (see NeuralNet::SaveBinary)
+	///the file is mapped instead of read, DenseL and ConvL parameters are used in place through Eigen::Map,
+	///so startup does not depend on the model size and processes on one host share a single copy of the weights
+	///(except for conv layers tuned to FFT or Winograd, see MappedConvL)
+	///the remaining layers are small and are copied out of the mapping
+	template <typename T> class BasicMappedNet {
+	private:
+		MappedFile file;
+		int in_sz, out_sz;
+		///Exactly one of layers[i], dense[i] and conv[i] is set
+		std::vector<std::unique_ptr<BasicLayer<T>>> layers;
+		std::vector<std::unique_ptr<MappedDenseL<T>>> dense;
+		std::vector<std::unique_ptr<MappedConvL<T>>> conv;
+	public:
+		///The file has to store scalars of type T, verify = true checks the checksum, which reads the whole file once
+		BasicMappedNet(const std::string& path, bool verify = false);
+
+		int InSize() const;
+		int OutSize() const;
+
+		///Size of the mapping, pages are only loaded when they are first used
+		size_t MappedBytes() const;
+
+		///Same as NeuralNet::Infer, any number of threads can infer concurrently, each with its own workspace
+		const Eigen::MatrixX<T>& Infer(const Eigen::MatrixX<T>& in, BasicWorkspace<T>& ws) const;
+
+		///Thread-safe as well, but build a fresh workspace on every call
+		Eigen::VectorX<T> Query(const Eigen::VectorX<T>& in) const;
+		Eigen::MatrixX<T> QueryBatch(const Eigen::MatrixX<T>& in) const;
+	};
+
+	typedef BasicMappedNet<double> MappedNet;
+	typedef BasicMappedNet<float> MappedNetf;
+}
@@ -1,8 +1,9 @@
 #include "pch.h"
 #include "neural_net.h"
+#include "checkpoint.h"
 
 namespace NNet {
-	NeuralNet::NeuralNet(int input_sz, const std::vector<Layer*>& layers, d_F_vd_vd LossFunc, vd_F_vd_vd LossDeriv, d_F RandGen) 
+	template <typename T> BasicNeuralNet<T>::BasicNeuralNet(int input_sz, const std::vector<BasicLayer<T>*>& layers, s_F_v_v<T> LossFunc, v_F_v_v<T> LossDeriv, d_F RandGen) 
 	: in_sz(input_sz), layers(layers), LossFunc(LossFunc), LossDeriv(LossDeriv) 
 	{
         for (auto& layer : layers) {
@@ -12,9 +13,10 @@ namespace NNet {
 		}
 
 		out_sz = input_sz;
+		FindSoftmaxHead();
 	}
 
-	NeuralNet::NeuralNet(const NeuralNet& other) {
+	template <typename T> BasicNeuralNet<T>::BasicNeuralNet(const BasicNeuralNet& other) {
 		in_sz = other.InSize();
 		out_sz = other.OutSize();
 
@@ -22,100 +24,288 @@ namespace NNet {
 		LossDeriv = other.GetLossDeriv();
 
 		layers = other.LayersCopy();
+		FindSoftmaxHead();
 	}
 
-	NeuralNet::NeuralNet(std::istream& istr) {
+	template <typename T> BasicNeuralNet<T>::BasicNeuralNet(std::istream& istr) {
 		Load(istr);
 	}
 
-	NeuralNet::NeuralNet(const std::string& path) {
+	template <typename T> BasicNeuralNet<T>::BasicNeuralNet(const std::string& path) {
 		Load(path);
 	}
 
-	NeuralNet::~NeuralNet() {
+	template <typename T> BasicNeuralNet<T>::~BasicNeuralNet() {
 		for (auto& e : layers) delete e;
 	}
 
-	int NeuralNet::InSize() const { return in_sz; }
-	int NeuralNet::OutSize() const { return out_sz; }
+	template <typename T> void BasicNeuralNet<T>::FindSoftmaxHead() {
+		softmax_head = nullptr;
+		if (layers.empty() || LossFunc != CrossEntropyLoss<T> || LossDeriv != CrossEntropyLossDeriv<T>) return;
 
-	d_F_vd_vd NeuralNet::GetLossFunc() const { return LossFunc; }
-	vd_F_vd_vd NeuralNet::GetLossDeriv() const { return LossDeriv; }
+		auto act = dynamic_cast<BasicActL<T>*>(layers.back());
+		if (act && act->GetActFunc() == Softmax<T>) softmax_head = act;
+	}
+
+	template <typename T> int BasicNeuralNet<T>::InSize() const { return in_sz; }
+	template <typename T> int BasicNeuralNet<T>::OutSize() const { return out_sz; }
 
-	std::vector<Layer*> NeuralNet::LayersCopy() const {
-		std::vector<Layer*> cpy;
+	template <typename T> s_F_v_v<T> BasicNeuralNet<T>::GetLossFunc() const { return LossFunc; }
+	template <typename T> v_F_v_v<T> BasicNeuralNet<T>::GetLossDeriv() const { return LossDeriv; }
+
+	template <typename T> std::vector<BasicLayer<T>*> BasicNeuralNet<T>::LayersCopy() const {
+		std::vector<BasicLayer<T>*> cpy;
 		for (auto& layer : layers) cpy.push_back(layer->Clone());
 
 		return cpy;
 	}
 
-	Eigen::VectorXd NeuralNet::Query(const Eigen::VectorXd& in) {
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicNeuralNet<T>::Params() {
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> ret;
+		for (auto& layer : layers) {
+			for (auto& block : layer->Params()) ret.push_back(block);
+		}
+		return ret;
+	}
+	template <typename T> void BasicNeuralNet<T>::ParamsChanged() {
+		for (auto& layer : layers) layer->ParamsChanged();
+	}
+
+	template <typename T> Eigen::VectorX<T> BasicNeuralNet<T>::Query(const Eigen::VectorX<T>& in) {
 		if (in.size() != in_sz) throw Exception("NeuralNet::Query: Rececived input vector is not the right size!");
 
-		Eigen::VectorXd ret = in;
+		Eigen::VectorX<T> ret = in;
 		for (auto& layer : layers) ret = layer->Forward(ret);
 
 		return ret;
 	}
-	Eigen::VectorXd NeuralNet::Query(const std::vector<double>& in) {
+	template <typename T> Eigen::VectorX<T> BasicNeuralNet<T>::Query(const std::vector<T>& in) {
 		return Query(Vec2Eig(in));
 	}
 	
-	Eigen::VectorXd NeuralNet::BackQuery(const Eigen::VectorXd& grads) {
+	template <typename T> Eigen::VectorX<T> BasicNeuralNet<T>::BackQuery(const Eigen::VectorX<T>& grads) {
 		if (grads.size() != out_sz) throw Exception("NeuralNet::BackQuery: Rececived gradients list is not the right size!");
-		Eigen::VectorXd ret = grads;
+		Eigen::VectorX<T> ret = grads;
 		for (int i = layers.size() - 1; i >= 0; i--) ret = layers[i]->Backward(ret);
 
 		return ret;
 	}
 
-	double NeuralNet::Fit(const Eigen::VectorXd& in, const Eigen::VectorXd& target) {
-		if(in.size() != in_sz) throw Exception("NeuralNet::Fit: Rececived input vector is not the right size!");
-		if(target.size() != out_sz) throw Exception("NeuralNet::Fit: Rececived target vector is not the right size!");
-		Eigen::VectorXd out = Query(in);
-		double loss = LossFunc(out, target);
+	template <typename T> double BasicNeuralNet<T>::Fit(const Eigen::VectorX<T>& in, const Eigen::VectorX<T>& target) {
+		return FitBatch(in, target);
+	}
+	template <typename T> double BasicNeuralNet<T>::Fit(const std::vector<T>& in, const std::vector<T>& target) {
+		return Fit(Vec2Eig(in), Vec2Eig(target));
+	}
+
+	template <typename T> Eigen::MatrixX<T> BasicNeuralNet<T>::QueryBatch(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_sz) throw Exception("NeuralNet::QueryBatch: Rececived input matrix is not the right size!");
 
-		BackQuery(LossDeriv(out, target));
+		Eigen::MatrixX<T> ret = in;
+		for (auto& layer : layers) ret = layer->ForwardBatch(ret);
 
-		return loss;
+		return ret;
 	}
-	double NeuralNet::Fit(const std::vector<double>& in, const std::vector<double>& target) {
-		return Fit(Vec2Eig(in), Vec2Eig(target));
+
+	template <typename T> const Eigen::MatrixX<T>& BasicNeuralNet<T>::Infer(const Eigen::MatrixX<T>& in, BasicWorkspace<T>& ws) const {
+		if (in.rows() != in_sz) throw Exception("NeuralNet::Infer: Rececived input matrix is not the right size!");
+		if (ws.layers.size() != layers.size()) {
+			ws.layers.clear();
+			ws.layers.resize(layers.size());
+		}
+		if (layers.empty()) return ws.buffers[0] = in;
+
+		// layer i reads the output of layer i - 1 and writes the other buffer
+		const Eigen::MatrixX<T>* cur = &in;
+		for (int i = 0; i < layers.size(); i++) {
+			layers[i]->Infer(*cur, ws.buffers[i % 2], ws.layers[i]);
+			cur = &ws.buffers[i % 2];
+		}
+
+		return *cur;
+	}
+	template <typename T> Eigen::VectorX<T> BasicNeuralNet<T>::Infer(const Eigen::VectorX<T>& in, BasicWorkspace<T>& ws) const {
+		return Infer(Eigen::MatrixX<T>(in), ws);
+	}
+
+	template <typename T> Eigen::MatrixX<T> BasicNeuralNet<T>::BackQueryBatch(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != out_sz) throw Exception("NeuralNet::BackQueryBatch: Rececived gradients matrix is not the right size!");
+		Eigen::MatrixX<T> ret = grads;
+		for (int i = layers.size() - 1; i >= 0; i--) ret = layers[i]->BackwardBatch(ret);
+
+		return ret;
 	}
 
-	std::istream& NeuralNet::Load(std::istream& istr) {
+	template <typename T> double BasicNeuralNet<T>::FitBatch(const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target) {
+		if (in.rows() != in_sz) throw Exception("NeuralNet::FitBatch: Rececived input matrix is not the right size!");
+		if (target.rows() != out_sz || target.cols() != in.cols()) throw Exception("NeuralNet::FitBatch: Rececived target matrix is not the right size!");
+		if (softmax_head) return FitSoftmaxHead(in, target);
+
+		Eigen::MatrixX<T> out = QueryBatch(in);
+
+		double loss = 0.;
+		Eigen::MatrixX<T> grads(out_sz, out.cols());
+		for (int i = 0; i < out.cols(); i++) {
+			loss += LossFunc(out.col(i), target.col(i));
+			grads.col(i) = LossDeriv(out.col(i), target.col(i));
+		}
+
+		BackQueryBatch(grads);
+
+		return loss / out.cols();
+	}
+
+	template <typename T> void BasicNeuralNet<T>::Autotune() {
+		if (!ConvAutotune()) return;
+
+		for (auto& layer : layers) {
+			auto conv = dynamic_cast<BasicConvL<T>*>(layer);
+			if (conv) conv->Autotune();
+		}
+	}
+
+	template <typename T> double BasicNeuralNet<T>::FitSoftmaxHead(const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target) {
+		Eigen::MatrixX<T> logits = in;
+		for (int i = 0; i + 1 < layers.size(); i++) logits = layers[i]->ForwardBatch(logits);
+		logits = softmax_head->ForwardLinear(logits);
+
+		// derivative of CrossEntropyLoss(Softmax(z)) with respect to z is simply Softmax(z) - target
+		double loss = 0.;
+		Eigen::MatrixX<T> grads(out_sz, logits.cols());
+		for (int i = 0; i < logits.cols(); i++) {
+			Eigen::VectorX<T> logp = LogSoftmax<T>(logits.col(i));
+			loss -= target.col(i).dot(logp);
+			grads.col(i) = logp.array().exp().matrix() - target.col(i);
+		}
+
+		Eigen::MatrixX<T> ret = softmax_head->BackwardLinear(grads);
+		for (int i = layers.size() - 2; i >= 0; i--) ret = layers[i]->BackwardBatch(ret);
+
+		return loss / logits.cols();
+	}
+
+	template <typename T> template <typename Src> BasicLayer<T>* BasicNeuralNet<T>::MakeLayer(const std::string& id, Src& src) {
+		if (id == "Dense") return new BasicDenseL<T>(src);
+		if (id == "Act") return new BasicActL<T>(src);
+		if (id == "Conv") return new BasicConvL<T>(src);
+		if (id == "CrossConv") return new BasicCrossConvL<T>(src);
+		if (id == "SepConv") return new BasicSepConvL<T>(src);
+		if (id == "Pool") return new BasicPoolL<T>(src);
+		throw Exception("NeuralNet::Load: data in the given stream cannot be interpreted as a NeuralNet!");
+	}
+
+	template <typename T> std::istream& BasicNeuralNet<T>::Load(std::istream& istr) {
+		istr >> std::ws;
+		if (istr.peek() == BINARY_MAGIC[0]) return LoadBinary(istr);
+
         for (auto& e : layers) delete e;
         layers.clear();
 
+		// the scalar type the net was saved with comes first, files without it start with the layer count
+		// parameters are stored as text, so a net saved with the other scalar type is converted while reading
+		std::string scalar;
+		istr >> scalar;
+		if (scalar == ScalarName<float>() || scalar == ScalarName<double>()) istr >> scalar;
+
 		int lcnt;
-		istr >> lcnt >> in_sz >> out_sz >> LossFunc >> LossDeriv;
+		try { lcnt = std::stoi(scalar); }
+		catch (const std::exception&) { throw Exception("NeuralNet::Load: data in the given stream cannot be interpreted as a NeuralNet!"); }
+		istr >> in_sz >> out_sz >> LossFunc >> LossDeriv;
 
         int sz = in_sz;
 		std::string id;
 		for (int i = 0; i < lcnt; i++) {
 			istr >> id;
-            if (id == "Dense") layers.push_back(new DenseL(istr));
-            else if (id == "Act") layers.push_back(new ActL(istr));
-            else if (id == "Conv") layers.push_back(new ConvL(istr));
-            else if (id == "Pool") layers.push_back(new PoolL(istr));
-			else throw Exception("NeuralNet::Load: data in the given stream cannot be interpreted as a NeuralNet!");
+			layers.push_back(MakeLayer(id, istr));
 		}
+		FindSoftmaxHead();
 
 		return istr;
 	}
-	void NeuralNet::Load(const std::string& path) {
-		std::ifstream istr{path};
+	template <typename T> void BasicNeuralNet<T>::Load(const std::string& path) {
+		std::ifstream istr{ path, std::ios::binary };
+		if (!istr) throw Exception("NeuralNet::Load: Cannot open " + path + "!");
 		Load(istr);
 	}
 
-	std::ostream& NeuralNet::Save(std::ostream& ostr) const {
-		ostr << layers.size() << ' ' << in_sz << ' ' << out_sz << ' ' << LossFunc << LossDeriv << '\n';
+	template <typename T> std::ostream& BasicNeuralNet<T>::Save(std::ostream& ostr) const {
+		ostr << ScalarName<T>() << ' ' << layers.size() << ' ' << in_sz << ' ' << out_sz << ' ' << LossFunc << LossDeriv << '\n';
 		for (auto& layer : layers) layer->Write(ostr);
 		return ostr;
 	}
-	void NeuralNet::Save(const std::string& path) const {
-		if(system(("type nul > " + path).c_str())) throw Exception("NeuralNet::Save: Invalid path name!");
-		std::ofstream ostr{ path };
+	template <typename T> void BasicNeuralNet<T>::Save(const std::string& path) const {
+		std::ostringstream ostr;
 		Save(ostr);
+		WriteFileAtomic(path, ostr.str());
+	}
+
+	template <typename T> std::istream& BasicNeuralNet<T>::LoadBinary(std::istream& istr) {
+		std::string data{ std::istreambuf_iterator<char>(istr), std::istreambuf_iterator<char>() };
+		LoadBinary(data.data(), data.size());
+		return istr;
 	}
+	template <typename T> void BasicNeuralNet<T>::LoadBinary(const char* data, size_t size) {
+		BinaryModelInfo info = ReadBinaryModelInfo(data, size);
+
+		for (auto& e : layers) delete e;
+		layers.clear();
+
+		in_sz = info.in_sz;
+		out_sz = info.out_sz;
+		std::istringstream funcs{ std::to_string(info.loss) + ' ' + std::to_string(info.loss_deriv) };
+		funcs >> LossFunc >> LossDeriv;
+
+		BinaryReader reader{ data, size, (int)info.scalar_size };
+		for (auto& entry : info.layers) {
+			reader.Seek(entry.offset);
+			layers.push_back(MakeLayer(entry.id, reader));
+			if (reader.Tell() > entry.offset + entry.size) throw Exception("NeuralNet::LoadBinary: Layer " + entry.id + " reads past its record!");
+		}
+		FindSoftmaxHead();
+	}
+
+	template <typename T> std::ostream& BasicNeuralNet<T>::SaveBinary(std::ostream& ostr) const {
+		BinaryWriter writer;
+		for (char c : BINARY_MAGIC) writer.Put(c);
+		writer.Put<uint32_t>(BINARY_VERSION);
+		writer.Put<uint32_t>(sizeof(T));
+		writer.Put<uint32_t>(layers.size());
+		writer.Put<uint32_t>(in_sz);
+		writer.Put<uint32_t>(out_sz);
+		writer.PutFunc(LossFunc);
+		writer.PutFunc(LossDeriv);
+		size_t table_pos = writer.Size();
+		writer.Put<uint64_t>(0);
+
+		std::vector<BinaryLayerEntry> entries;
+		for (auto& layer : layers) {
+			writer.Align();
+			// the size is only known once the layer is written
+			BinaryLayerEntry entry{ layer->ID(), writer.Size(), 0 };
+			layer->WriteBinary(writer);
+			entry.size = writer.Size() - entry.offset;
+			entries.push_back(entry);
+		}
+
+		writer.Align();
+		writer.Patch<uint64_t>(table_pos, writer.Size());
+		for (auto& entry : entries) {
+			char id[BINARY_ID_SIZE] = {};
+			entry.id.copy(id, BINARY_ID_SIZE);
+			writer.Put(id);
+			writer.Put<uint64_t>(entry.offset);
+			writer.Put<uint64_t>(entry.size);
+		}
+		writer.Put<uint64_t>(Checksum(writer.Buffer().data(), writer.Size()));
+
+		return ostr.write(writer.Buffer().data(), writer.Size());
+	}
+	template <typename T> void BasicNeuralNet<T>::SaveBinary(const std::string& path) const {
+		std::ostringstream ostr;
+		SaveBinary(ostr);
+		WriteFileAtomic(path, ostr.str());
+	}
+
+	template class BasicNeuralNet<float>;
+	template class BasicNeuralNet<double>;
 }
\ No newline at end of file
@@ -2,44 +2,102 @@
 
 #include "helpers.h"
 #include "layer.h"
+#include "conv_tuner.h"
 #include <iostream>
 #include <fstream>
 
 namespace NNet {
-	class NeuralNet {
+	///Per-thread scratch state of NeuralNet::Infer: a workspace for every layer plus two ping-pong activation buffers
+	///built on the first call and reused afterwards, so repeated calls with the same batch size don't resize any of them
+	///this is not a no-allocation guarantee: Eigen's matrix products, the conv engines and custom ActFuncs still use temporaries
+	template <typename T> struct BasicWorkspace {
+		std::vector<LayerWorkspace<T>> layers;
+		Eigen::MatrixX<T> buffers[2];
+	};
+
+	typedef BasicWorkspace<double> Workspace;
+	typedef BasicWorkspace<float> Workspacef;
+
+	///Feed-forward network over scalar type T (float or double), NeuralNet is the double variant
+	template <typename T> class BasicNeuralNet {
 	private:
-		d_F_vd_vd LossFunc;
-		vd_F_vd_vd LossDeriv;
+		s_F_v_v<T> LossFunc;
+		v_F_v_v<T> LossDeriv;
 
 		int in_sz, out_sz;
-		std::vector<Layer*> layers;
+		std::vector<BasicLayer<T>*> layers;
+
+		///Last layer when it is ActL(Softmax) trained with CrossEntropyLoss, nullptr otherwise
+		///such networks are trained through a fused softmax-cross-entropy stage
+		BasicActL<T>* softmax_head;
+
+		void FindSoftmaxHead();
+		double FitSoftmaxHead(const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target);
+		///Constructs the layer with the given id from a text stream or a BinaryReader
+		template <typename Src> static BasicLayer<T>* MakeLayer(const std::string& id, Src& src);
 	public:
-		NeuralNet(int input_sz, const std::vector<Layer*>& layers, d_F_vd_vd LossFunc, vd_F_vd_vd LossDeriv, d_F RandGen = DefaultRandom);
-		NeuralNet(const NeuralNet& other);
-		NeuralNet(std::istream& istr);
-		NeuralNet(const std::string& path);
-		~NeuralNet();
+		BasicNeuralNet(int input_sz, const std::vector<BasicLayer<T>*>& layers, s_F_v_v<T> LossFunc, v_F_v_v<T> LossDeriv, d_F RandGen = DefaultRandom);
+		BasicNeuralNet(const BasicNeuralNet& other);
+		BasicNeuralNet(std::istream& istr);
+		BasicNeuralNet(const std::string& path);
+		~BasicNeuralNet();
 
-		d_F_vd_vd GetLossFunc() const;
-		vd_F_vd_vd GetLossDeriv() const;
+		s_F_v_v<T> GetLossFunc() const;
+		v_F_v_v<T> GetLossDeriv() const;
 
 		int InSize() const;
 		int OutSize() const;
 
-		std::vector<Layer*> LayersCopy() const;
+		std::vector<BasicLayer<T>*> LayersCopy() const;
+
+		///Parameter blocks of all layers in layer order, see Layer::Params
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> Params();
+		///Has to be called after parameters were written through Params
+		void ParamsChanged();
+
+		Eigen::VectorX<T> Query(const Eigen::VectorX<T>& in);
+		Eigen::VectorX<T> Query(const std::vector<T>& in);
 
-		Eigen::VectorXd Query(const Eigen::VectorXd& in);
-		Eigen::VectorXd Query(const std::vector<double>& in);
+		Eigen::VectorX<T> BackQuery(const Eigen::VectorX<T>& grads);
 
-		Eigen::VectorXd BackQuery(const Eigen::VectorXd& grads);
+		double Fit(const Eigen::VectorX<T>& in, const Eigen::VectorX<T>& target);
+		double Fit(const std::vector<T>& in, const std::vector<T>& target);
 
-		double Fit(const Eigen::VectorXd& in, const Eigen::VectorXd& target);
-		double Fit(const std::vector<double>& in, const std::vector<double>& target);
+		///Batched variants, one sample per column
+		Eigen::MatrixX<T> QueryBatch(const Eigen::MatrixX<T>& in);
+		Eigen::MatrixX<T> BackQueryBatch(const Eigen::MatrixX<T>& grads);
 
+		///Inference without the per-layer caches of QueryBatch, all scratch memory lives in the caller's workspace
+		///any number of threads can infer concurrently on one net, each with its own workspace, as long as nothing trains it meanwhile
+		///the result refers into ws and stays valid until its next use
+		///Infer never benchmarks conv engines, call Autotune before serving or untuned ConvL layers run their default engine
+		const Eigen::MatrixX<T>& Infer(const Eigen::MatrixX<T>& in, BasicWorkspace<T>& ws) const;
+		Eigen::VectorX<T> Infer(const Eigen::VectorX<T>& in, BasicWorkspace<T>& ws) const;
+
+		///Benchmarks the engines of ConvL layers left on CONV_AUTO now (see TunedConvAlgo)
+		///otherwise each of them is tuned on its first training forward pass (never by Infer), building or loading a net never benchmarks
+		void Autotune();
+
+		///Trains on the whole batch with a single parameter update, returns the average loss
+		///with a fused softmax-cross-entropy stage targets are expected to sum up to 1 (e.g. one-hot)
+		double FitBatch(const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target);
+
+		///Reads both the text and the binary format, the format is detected from the first bytes
 		std::istream& Load(std::istream& istr);
 		void Load(const std::string& path);
 
 		std::ostream& Save(std::ostream& ostr) const;
+		///Replaces the file atomically, a crash during the write leaves the previous contents (see WriteFileAtomic)
 		void Save(const std::string& path) const;
+
+		///Versioned binary format with raw parameter blobs and a checksum, see binary_io.h
+		std::istream& LoadBinary(std::istream& istr);
+		void LoadBinary(const char* data, size_t size);
+
+		std::ostream& SaveBinary(std::ostream& ostr) const;
+		void SaveBinary(const std::string& path) const;
 	};
+
+	typedef BasicNeuralNet<double> NeuralNet;
+	typedef BasicNeuralNet<float> NeuralNetf;
 }
\ No newline at end of file
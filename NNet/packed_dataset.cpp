@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "packed_dataset.h"
+#include "checkpoint.h"
+#include "errors.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace NNet {
+	static size_t AlignPack(size_t pos) { return (pos + PACK_HEADER - 1) / PACK_HEADER * PACK_HEADER; }
+
+	///File name without its directory
+	static std::string BaseName(const std::string& path) {
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+	///Directory of path including the trailing separator, empty for bare file names
+	static std::string DirName(const std::string& path) {
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+	}
+
+	bool PackedDatasetExists(const std::string& prefix) {
+		return (bool)std::ifstream{ prefix + ".index" };
+	}
+
+	// --------------- PackedDatasetWriter --------------- //
+
+	PackedDatasetWriter::PackedDatasetWriter(const std::string& prefix, int depth, int height, int width, const std::vector<std::string>& class_names, int shard_samples) :
+		prefix(prefix), depth(depth), height(height), width(width), class_names(class_names), shard_samples(shard_samples), closed(false)
+	{
+		if (depth <= 0 || height <= 0 || width <= 0) throw Exception("PackedDatasetWriter::PackedDatasetWriter: Sample dimensions must be positive!");
+		if (class_names.empty() || class_names.size() > 65536) throw Exception("PackedDatasetWriter::PackedDatasetWriter: Between 1 and 65536 classes are supported!");
+		if (shard_samples <= 0) throw Exception("PackedDatasetWriter::PackedDatasetWriter: Shard size must be positive!");
+		for (auto& name : class_names) {
+			if (name.empty() || name.find_first_of(" \t\r\n") != std::string::npos) throw Exception("PackedDatasetWriter::PackedDatasetWriter: Class names can't be empty or contain whitespace!");
+		}
+	}
+
+	PackedDatasetWriter::~PackedDatasetWriter() {
+		try { Close(); }
+		catch (...) {}
+	}
+
+	int PackedDatasetWriter::Size() const {
+		int ret = labels.size();
+		for (auto& s : shards) ret += s.second;
+		return ret;
+	}
+
+	void PackedDatasetWriter::Add(const uint8_t* sample, int label) {
+		if (closed) throw Exception("PackedDatasetWriter::Add: Writer is already closed!");
+		if (label < 0 || label >= class_names.size()) throw Exception("PackedDatasetWriter::Add: Label out of range!");
+
+		if (!shard.is_open()) {
+			std::string path = prefix + '.' + std::to_string(shards.size()) + ".shard";
+			shard.open(path, std::ios::binary | std::ios::trunc);
+			if (!shard) throw Exception("PackedDatasetWriter::Add: Cannot open " + path + "!");
+			// the sample count is patched in by FinishShard
+			char header[PACK_HEADER] = {};
+			shard.write(header, PACK_HEADER);
+		}
+
+		shard.write(reinterpret_cast<const char*>(sample), (std::streamsize)depth * height * width);
+		labels.push_back((uint16_t)label);
+		if (labels.size() == shard_samples) FinishShard();
+	}
+
+	void PackedDatasetWriter::FinishShard() {
+		uint32_t header[2] = { (uint32_t)labels.size(), (uint32_t)(depth * height * width) };
+
+		size_t end = PACK_HEADER + (size_t)header[0] * header[1];
+		shard.write(std::string(AlignPack(end) - end, '\0').data(), AlignPack(end) - end);
+		shard.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(uint16_t));
+
+		shard.seekp(0);
+		shard.write(SHARD_MAGIC, sizeof(SHARD_MAGIC));
+		shard.write(reinterpret_cast<const char*>(header), sizeof(header));
+		shard.close();
+		if (shard.fail()) throw Exception("PackedDatasetWriter::FinishShard: Writing the shard failed!");
+
+		shards.emplace_back(BaseName(prefix) + '.' + std::to_string(shards.size()) + ".shard", (int)labels.size());
+		labels.clear();
+	}
+
+	void PackedDatasetWriter::Close() {
+		if (closed) return;
+		closed = true;
+		if (shard.is_open()) FinishShard();
+
+		std::ostringstream index;
+		index << "NNETPACK 1\n" << depth << ' ' << height << ' ' << width << '\n' << class_names.size() << '\n';
+		for (auto& name : class_names) index << name << '\n';
+		index << shards.size() << '\n';
+		for (auto& s : shards) index << s.first << ' ' << s.second << '\n';
+		WriteFileAtomic(prefix + ".index", index.str());
+	}
+
+	// --------------- PackedDataset --------------- //
+
+	PackedDataset::PackedDataset(const std::string& prefix) {
+		std::ifstream index{ prefix + ".index" };
+		if (!index) throw Exception("PackedDataset::PackedDataset: Cannot open " + prefix + ".index!");
+
+		std::string magic;
+		int version, class_cnt, shard_cnt;
+		index >> magic >> version >> depth >> height >> width >> class_cnt;
+		if (!index || magic != "NNETPACK" || version != 1) throw Exception("PackedDataset::PackedDataset: " + prefix + ".index is not a packed dataset index!");
+		if (depth <= 0 || height <= 0 || width <= 0 || class_cnt <= 0) throw Exception("PackedDataset::PackedDataset: Invalid dimensions in the index!");
+
+		class_names.resize(class_cnt);
+		for (auto& name : class_names) index >> name;
+		index >> shard_cnt;
+		if (!index || shard_cnt < 0) throw Exception("PackedDataset::PackedDataset: Index is truncated!");
+
+		size_t sample_sz = (size_t)depth * height * width;
+		starts.push_back(0);
+		for (int s = 0; s < shard_cnt; s++) {
+			std::string name;
+			int count;
+			if (!(index >> name >> count) || count < 0) throw Exception("PackedDataset::PackedDataset: Index is truncated!");
+
+			shards.emplace_back(new MappedFile(DirName(prefix) + name));
+			const char* data = shards.back()->Data();
+			size_t size = shards.back()->Size();
+
+			uint32_t header[2];
+			if (size < PACK_HEADER || std::memcmp(data, SHARD_MAGIC, sizeof(SHARD_MAGIC))) throw Exception("PackedDataset::PackedDataset: " + name + " is not a shard!");
+			std::memcpy(header, data + sizeof(SHARD_MAGIC), sizeof(header));
+			if (header[0] != (uint32_t)count || header[1] != sample_sz) throw Exception("PackedDataset::PackedDataset: " + name + " doesn't match the index!");
+
+			size_t label_pos = AlignPack(PACK_HEADER + count * sample_sz);
+			if (size < label_pos + count * sizeof(uint16_t)) throw Exception("PackedDataset::PackedDataset: " + name + " is truncated!");
+
+			pixels.push_back(reinterpret_cast<const uint8_t*>(data + PACK_HEADER));
+			labels.push_back(reinterpret_cast<const uint16_t*>(data + label_pos));
+			starts.push_back(starts.back() + count);
+		}
+	}
+
+	int PackedDataset::Size() const { return starts.back(); }
+	int PackedDataset::InputSize() const { return depth * height * width; }
+	int PackedDataset::Classes() const { return class_names.size(); }
+
+	int PackedDataset::Depth() const { return depth; }
+	int PackedDataset::Height() const { return height; }
+	int PackedDataset::Width() const { return width; }
+	const std::string& PackedDataset::ClassName(int label) const { return class_names.at(label); }
+
+	int PackedDataset::Shards() const { return shards.size(); }
+	int PackedDataset::ShardStart(int s) const { return starts.at(s); }
+
+	int PackedDataset::Locate(int i, int& pos) const {
+		if (i < 0 || i >= Size()) throw Exception("PackedDataset::Locate: Index out of range!");
+		int s = std::upper_bound(starts.begin(), starts.end(), i) - starts.begin() - 1;
+		pos = i - starts[s];
+		return s;
+	}
+
+	int PackedDataset::Label(int i) const {
+		int pos, s = Locate(i, pos);
+		return labels[s][pos];
+	}
+	const uint8_t* PackedDataset::Sample(int i) const {
+		int pos, s = Locate(i, pos);
+		return pixels[s] + (size_t)pos * InputSize();
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "dataset.h"
+#include "mapped_file.h"
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace NNet {
+	// Packed datasets are a text index file plus numbered binary shards next to it:
+	//   <prefix>.index     "NNETPACK 1", depth height width, class count and one name per class, shard count
+	//                      and one "<file name> <sample count>" line per shard
+	//   <prefix>.<n>.shard magic "NNETSHRD", u32 sample count, u32 sample size, padding to PACK_HEADER bytes,
+	//                      count * size uint8 values, padding to a multiple of PACK_HEADER bytes, count uint16 labels
+	// samples are in the layout ThreeDToVec produces; the index is written last, so a dataset is only visible once complete
+	const char SHARD_MAGIC[8] = { 'N', 'N', 'E', 'T', 'S', 'H', 'R', 'D' };
+	const int PACK_HEADER = 64;
+
+	///Packs labelled uint8 samples into shards of at most shard_samples samples each
+	///samples are streamed to disk as they are added, so memory use doesn't depend on the dataset size
+	class PackedDatasetWriter {
+	private:
+		std::string prefix;
+		int depth, height, width;
+		std::vector<std::string> class_names;
+		int shard_samples;
+
+		std::ofstream shard;
+		std::vector<uint16_t> labels;
+		std::vector<std::pair<std::string, int>> shards;
+		bool closed;
+
+		void FinishShard();
+	public:
+		PackedDatasetWriter(const std::string& prefix, int depth, int height, int width, const std::vector<std::string>& class_names, int shard_samples = 16384);
+		PackedDatasetWriter(const PackedDatasetWriter&) = delete;
+		PackedDatasetWriter& operator=(const PackedDatasetWriter&) = delete;
+		///Calls Close, errors are only reported through an explicit Close
+		~PackedDatasetWriter();
+
+		///depth * height * width values
+		void Add(const uint8_t* sample, int label);
+		///Finishes the last shard and writes the index
+		void Close();
+
+		int Size() const;
+	};
+
+	///Packed dataset with every shard memory-mapped
+	///pages are read from disk when a sample is first used and can be evicted again, so datasets larger than RAM work;
+	///visiting samples in index order streams through the shards one after another
+	class PackedDataset : public Dataset {
+	private:
+		int depth, height, width;
+		std::vector<std::string> class_names;
+
+		std::vector<std::unique_ptr<MappedFile>> shards;
+		///First sample of every shard, plus the total size at the end
+		std::vector<int> starts;
+		std::vector<const uint8_t*> pixels;
+		std::vector<const uint16_t*> labels;
+
+		///Shard of sample i and its position in it
+		int Locate(int i, int& pos) const;
+	public:
+		///prefix is the one given to PackedDatasetWriter
+		PackedDataset(const std::string& prefix);
+
+		int Size() const override;
+		int InputSize() const override;
+		int Classes() const override;
+
+		int Depth() const;
+		int Height() const;
+		int Width() const;
+		const std::string& ClassName(int label) const;
+
+		int Shards() const;
+		///Index of the first sample of shard s
+		int ShardStart(int s) const;
+
+		int Label(int i) const override;
+		const uint8_t* Sample(int i) const override;
+	};
+
+	///True if the index of a packed dataset exists at prefix
+	bool PackedDatasetExists(const std::string& prefix);
+}
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "parallel_trainer.h"
+
+namespace NNet {
+	///Fewest parameters reduced by one task, below that scheduling costs more than the work
+	const Eigen::Index MIN_CHUNK_SIZE = 1 << 10;
+
+	template <typename T> BasicParallelTrainer<T>::BasicParallelTrainer(BasicNeuralNet<T>& net, int threads) : net(net), pool(threads) {
+		params = net.Params();
+		for (int k = 0; k < pool.Size(); k++) {
+			replicas.emplace_back(new BasicNeuralNet<T>(net));
+			replica_params.push_back(replicas.back()->Params());
+		}
+
+		// every thread gets about an equal share of all parameters, however few of them the net has
+		Eigen::Index total = 0;
+		for (auto& p : params) total += p.size();
+		Eigen::Index chunk_size = std::max(MIN_CHUNK_SIZE, (total + pool.Size() - 1) / pool.Size());
+
+		for (int b = 0; b < params.size(); b++) {
+			for (Eigen::Index first = 0; first < params[b].size(); first += chunk_size) {
+				chunks.push_back({ b, first, std::min(chunk_size, params[b].size() - first) });
+			}
+		}
+	}
+
+	template <typename T> int BasicParallelTrainer<T>::Threads() const { return pool.Size(); }
+
+	template <typename T> void BasicParallelTrainer<T>::Sync() {
+		pool.Run(chunks.size(), [this](int c) {
+			const Chunk& chunk = chunks[c];
+			for (auto& rp : replica_params) rp[chunk.block].segment(chunk.first, chunk.size) = params[chunk.block].segment(chunk.first, chunk.size);
+		});
+		for (auto& replica : replicas) replica->ParamsChanged();
+	}
+
+	template <typename T> double BasicParallelTrainer<T>::FitBatch(const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target) {
+		if (in.rows() != net.InSize() || target.rows() != net.OutSize() || in.cols() != target.cols()) throw Exception("ParallelTrainer::FitBatch: Batch sizes don't match the net!");
+
+		int n = in.cols(), k_cnt = replicas.size();
+		std::vector<double> losses(k_cnt, 0);
+		std::vector<int> begin(k_cnt + 1);
+		for (int k = 0; k <= k_cnt; k++) begin[k] = (long long)n * k / k_cnt;
+
+		pool.Run(k_cnt, [&](int k) {
+			int cnt = begin[k + 1] - begin[k];
+			if (cnt) losses[k] = replicas[k]->FitBatch(in.middleCols(begin[k], cnt), target.middleCols(begin[k], cnt));
+		});
+
+		// net += sum over replicas of (share of the batch) * (replica - net), then every replica starts from net again
+		pool.Run(chunks.size(), [&](int c) {
+			const Chunk& chunk = chunks[c];
+			auto master = params[chunk.block].segment(chunk.first, chunk.size);
+
+			Eigen::VectorX<T> delta = Eigen::VectorX<T>::Zero(chunk.size);
+			for (int k = 0; k < k_cnt; k++) {
+				int cnt = begin[k + 1] - begin[k];
+				if (cnt) delta += (T(cnt) / n) * (replica_params[k][chunk.block].segment(chunk.first, chunk.size) - master);
+			}
+			master += delta;
+
+			for (auto& rp : replica_params) rp[chunk.block].segment(chunk.first, chunk.size) = master;
+		});
+		net.ParamsChanged();
+		for (auto& replica : replicas) replica->ParamsChanged();
+
+		double loss = 0;
+		for (int k = 0; k < k_cnt; k++) loss += losses[k] * (begin[k + 1] - begin[k]) / n;
+		return loss;
+	}
+
+	template class BasicParallelTrainer<float>;
+	template class BasicParallelTrainer<double>;
+}
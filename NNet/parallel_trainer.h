@@ -0,0 +1,41 @@
+#pragma once
+
+#include "neural_net.h"
+#include "thread_pool.h"
+#include <memory>
+
+namespace NNet {
+	///Data-parallel training of one network on several threads
+	///every batch is split into one column block per thread, each block runs forward and backward on its own replica
+	///of the net, and the replica updates are combined into a single update of the net: since every layer applies
+	///lrate / n times its summed gradient, weighting each replica's change by its share of the batch gives exactly
+	///the update of net.FitBatch on the whole batch; the combination always runs in replica order,
+	///so results only depend on the batch and the thread count
+	template <typename T> class BasicParallelTrainer {
+	private:
+		BasicNeuralNet<T>& net;
+		ThreadPool pool;
+		std::vector<std::unique_ptr<BasicNeuralNet<T>>> replicas;
+
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> params;
+		std::vector<std::vector<Eigen::Map<Eigen::VectorX<T>>>> replica_params;
+
+		///Parameter ranges (block, first, length) reduced by one task
+		struct Chunk { int block; Eigen::Index first, size; };
+		std::vector<Chunk> chunks;
+	public:
+		///threads = 0 uses all hardware threads, net has to outlive the trainer and keep its layers while it lives
+		BasicParallelTrainer(BasicNeuralNet<T>& net, int threads = 0);
+
+		int Threads() const;
+
+		///Same as net.FitBatch(in, target), returns the average loss
+		double FitBatch(const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target);
+
+		///Copies the parameters of net to the replicas, needed after net was changed other than through FitBatch
+		void Sync();
+	};
+
+	typedef BasicParallelTrainer<double> ParallelTrainer;
+	typedef BasicParallelTrainer<float> ParallelTrainerf;
+}
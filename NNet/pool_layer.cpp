@@ -2,17 +2,26 @@
 #include "pool_layer.h"
 
 namespace NNet {
-    void PoolL::CalcOutSizes() {
+    template <typename T> void BasicPoolL<T>::CalcOutSizes() {
         out_h = (in_h - 1) / scan_h + 1;
         out_w = (in_w - 1) / scan_w + 1;
     }
+    template <typename T> void BasicPoolL<T>::FindKernel() {
+        if (PoolFunc == MaxPool<T> && PoolDeriv == MaxPoolDeriv<T>) kernel = POOL_MAX;
+        else if (PoolFunc == AvgPool<T> && PoolDeriv == AvgPoolDeriv<T>) kernel = POOL_AVG;
+        else kernel = POOL_CUSTOM;
+    }
+
+    template <typename T> int BasicPoolL<T>::WindowHeight(int r) const { return std::min(scan_h, in_h - r * scan_h); }
+    template <typename T> int BasicPoolL<T>::WindowWidth(int c) const { return std::min(scan_w, in_w - c * scan_w); }
 
-    PoolL::PoolL(int in_h, int in_w, int scan_h, int scan_w, d_F_md PoolFunc, md_F_md_d PoolDeriv) :
+    template <typename T> BasicPoolL<T>::BasicPoolL(int in_h, int in_w, int scan_h, int scan_w, s_F_m<T> PoolFunc, m_F_m_s<T> PoolDeriv) :
         in_h(in_h), in_w(in_w), scan_h(scan_h), scan_w(scan_w), PoolFunc(PoolFunc), PoolDeriv(PoolDeriv) {
         id = "Pool";
         CalcOutSizes();
+        FindKernel();
     }
-    PoolL::PoolL(const PoolL& other) {
+    template <typename T> BasicPoolL<T>::BasicPoolL(const BasicPoolL& other) {
         in_h = other.InHeight();
         in_w = other.InWidth();
         dep = other.InDepth();
@@ -25,76 +34,212 @@ namespace NNet {
 
         id = "Pool";
         CalcOutSizes();
+        FindKernel();
     }
-    PoolL::PoolL(std::istream& istr) {
+    template <typename T> BasicPoolL<T>::BasicPoolL(std::istream& istr) {
         Read(istr);
         id = "Pool";
     }
+    template <typename T> BasicPoolL<T>::BasicPoolL(BinaryReader& reader) {
+        ReadBinary(reader);
+        id = "Pool";
+    }
 
-    int PoolL::InHeight() const { return in_h; }
-    int PoolL::InWidth() const { return in_w; } 
-    int PoolL::InDepth() const { return dep; }
+    template <typename T> int BasicPoolL<T>::InHeight() const { return in_h; }
+    template <typename T> int BasicPoolL<T>::InWidth() const { return in_w; } 
+    template <typename T> int BasicPoolL<T>::InDepth() const { return dep; }
 
-    int PoolL::ScanHeight() const { return scan_h; }
-    int PoolL::ScanWidth() const { return scan_w; }
+    template <typename T> int BasicPoolL<T>::ScanHeight() const { return scan_h; }
+    template <typename T> int BasicPoolL<T>::ScanWidth() const { return scan_w; }
 
-    d_F_md PoolL::GetPoolFunc() const { return PoolFunc; }
-    md_F_md_d PoolL::GetPoolDeriv() const { return PoolDeriv; }
+    template <typename T> s_F_m<T> BasicPoolL<T>::GetPoolFunc() const { return PoolFunc; }
+    template <typename T> m_F_m_s<T> BasicPoolL<T>::GetPoolDeriv() const { return PoolDeriv; }
 
-    void PoolL::InitParams(d_F GenFunc) {}
-    void PoolL::SetInputSize(int input_sz) { 
+    template <typename T> void BasicPoolL<T>::InitParams(d_F GenFunc) {}
+    template <typename T> void BasicPoolL<T>::SetInputSize(int input_sz) { 
         if (input_sz % (in_h * in_w)) throw Exception("PoolL::SetInputSize: Make sure input size is divisible by in_h * in_w!");
         dep = input_sz / (in_h * in_w);
     }
 
-    int PoolL::OutSize() const { return dep * out_w * out_h; }
+    template <typename T> int BasicPoolL<T>::OutSize() const { return dep * out_w * out_h; }
+
+    // the channel kernels first reduce the rows of a window row with whole-row operations, then the
+    // columns of every window through maps with stride scan_w, one map per column offset inside the window
 
-    Eigen::VectorXd PoolL::Forward(const Eigen::VectorXd& in) {
-        auto real = VecTo3D(in, dep, in_h, in_w);
-        cache = real;
+    template <typename T> using ConstScanMap = Eigen::Map<const Eigen::ArrayX<T>, 0, Eigen::InnerStride<>>;
+    template <typename T> using ScanMap = Eigen::Map<Eigen::ArrayX<T>, 0, Eigen::InnerStride<>>;
 
-        std::vector<Eigen::MatrixXd> out;
+    template <typename T> void BasicPoolL<T>::MaxForward(Eigen::Map<const MatrixRX<T>> in, Eigen::Map<MatrixRX<T>> out, int* args, int offset) const {
+        Eigen::ArrayX<T> vmax(in_w), hmax(out_w);
+        Eigen::ArrayXi vrow(in_w), hcol(out_w);
 
-        for (const Eigen::MatrixXd& mat : real) {
-            out.push_back(Eigen::MatrixXd{out_h, out_w});
-            for (int i = 0; i < in_h; i += scan_h) {
-                for (int j = 0; j < in_w; j += scan_w)
-                    out.back()(i / scan_h, j / scan_w) = PoolFunc(mat.block(i, j, std::min(scan_h, (int)mat.rows() - i), std::min(scan_w, (int)mat.cols() - j)));
+        for (int r = 0; r < out_h; r++) {
+            int y = r * scan_h;
+            vmax = in.row(y).transpose().array();
+            vrow.setConstant(y);
+            for (int k = 1; k < WindowHeight(r); k++) {
+                auto row = in.row(y + k).transpose().array();
+                auto mask = row > vmax;
+                vrow = mask.select(Eigen::ArrayXi::Constant(in_w, y + k), vrow);
+                vmax = mask.select(row, vmax);
             }
+
+            hmax = ConstScanMap<T>(vmax.data(), out_w, Eigen::InnerStride<>(scan_w));
+            hcol = Eigen::ArrayXi::LinSpaced(out_w, 0, (out_w - 1) * scan_w);
+            for (int b = 1; b < scan_w; b++) {
+                int len = (in_w - b + scan_w - 1) / scan_w;
+                ConstScanMap<T> col(vmax.data() + b, len, Eigen::InnerStride<>(scan_w));
+                auto mask = col > hmax.head(len);
+                hcol.head(len) = mask.select(Eigen::ArrayXi::LinSpaced(len, b, b + (len - 1) * scan_w), hcol.head(len));
+                hmax.head(len) = mask.select(col, hmax.head(len));
+            }
+
+            out.row(r) = hmax.transpose().matrix();
+            if (args) for (int c = 0; c < out_w; c++) args[r * out_w + c] = offset + vrow(hcol(c)) * in_w + hcol(c);
         }
+    }
+
+    template <typename T> void BasicPoolL<T>::AvgForward(Eigen::Map<const MatrixRX<T>> in, Eigen::Map<MatrixRX<T>> out) const {
+        Eigen::ArrayX<T> vsum(in_w), hsum(out_w), count(out_w);
+        for (int c = 0; c < out_w; c++) count(c) = WindowWidth(c);
 
-        return ThreeDToVec(out);
+        for (int r = 0; r < out_h; r++) {
+            int y = r * scan_h;
+            vsum = in.middleRows(y, WindowHeight(r)).colwise().sum().transpose().array();
+
+            hsum.setZero();
+            for (int b = 0; b < scan_w; b++) {
+                int len = (in_w - b + scan_w - 1) / scan_w;
+                hsum.head(len) += ConstScanMap<T>(vsum.data() + b, len, Eigen::InnerStride<>(scan_w));
+            }
+
+            out.row(r) = (hsum / (count * WindowHeight(r))).transpose().matrix();
+        }
+    }
+    template <typename T> void BasicPoolL<T>::AvgBackward(Eigen::Map<const MatrixRX<T>> grads, Eigen::Map<MatrixRX<T>> out) const {
+        Eigen::ArrayX<T> scaled(out_w), count(out_w);
+        for (int c = 0; c < out_w; c++) count(c) = WindowWidth(c);
+
+        for (int r = 0; r < out_h; r++) {
+            scaled = grads.row(r).transpose().array() / (count * WindowHeight(r));
+            for (int y = r * scan_h; y < r * scan_h + WindowHeight(r); y++) {
+                for (int b = 0; b < scan_w; b++) {
+                    int len = (in_w - b + scan_w - 1) / scan_w;
+                    ScanMap<T>(out.row(y).data() + b, len, Eigen::InnerStride<>(scan_w)) = scaled.head(len);
+                }
+            }
+        }
     }
 
-    Eigen::VectorXd PoolL::Backward(const Eigen::VectorXd& grads) {
-        if (cache.empty()) throw Exception("PoolL::Backward: Backward without previous Forward!");
-        auto real = VecTo3D(grads, dep, out_h, out_w);
+    template <typename T> void BasicPoolL<T>::Pool(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& ret, Eigen::MatrixXi* args) const {
+        ret.resize(OutSize(), in.cols());
+        for (int s = 0; s < in.cols(); s++) {
+            TensorView<const T> real(in.col(s).data(), dep, in_h, in_w);
+            TensorView<T> out(ret.col(s).data(), dep, out_h, out_w);
+
+            for (int z = 0; z < dep; z++) {
+                if (kernel == POOL_MAX) MaxForward(real[z], out[z], args ? args->col(s).data() + z * out_h * out_w : nullptr, z * in_h * in_w);
+                else if (kernel == POOL_AVG) AvgForward(real[z], out[z]);
+                else {
+                    auto mat = real[z];
+                    for (int i = 0; i < in_h; i += scan_h) {
+                        for (int j = 0; j < in_w; j += scan_w)
+                            out[z](i / scan_h, j / scan_w) = PoolFunc(mat.block(i, j, std::min(scan_h, in_h - i), std::min(scan_w, in_w - j)));
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename T> Eigen::MatrixX<T> BasicPoolL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) {
+        if (in.rows() != dep * in_h * in_w) throw Exception("PoolL::ForwardBatch: Input size doesn't match!");
+
+        if (kernel == POOL_MAX) argmax.resize(OutSize(), in.cols());
+        else cache = in;
+
+        Eigen::MatrixX<T> ret;
+        Pool(in, ret, kernel == POOL_MAX ? &argmax : nullptr);
+        return ret;
+    }
+    template <typename T> void BasicPoolL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>&) const {
+        if (in.rows() != dep * in_h * in_w) throw Exception("PoolL::Infer: Input size doesn't match!");
+        Pool(in, out, nullptr);
+    }
+
+    template <typename T> Eigen::MatrixX<T> BasicPoolL<T>::BackwardBatch(const Eigen::MatrixX<T>& grads) {
+        int batch = (kernel == POOL_MAX) ? argmax.cols() : cache.cols();
+        if (batch == 0) throw Exception("PoolL::BackwardBatch: Backward without previous Forward!");
+        if (grads.cols() != batch) throw Exception("PoolL::BackwardBatch: Batch size doesn't match the previous Forward!");
+
+        Eigen::MatrixX<T> out(dep * in_h * in_w, grads.cols());
+        if (kernel == POOL_MAX) {
+            // windows don't overlap, so every input gets the gradient of at most one max
+            out.setZero();
+            for (int s = 0; s < grads.cols(); s++) {
+                for (int k = 0; k < grads.rows(); k++) out(argmax(k, s), s) = grads(k, s);
+            }
+            return out;
+        }
+
+        for (int s = 0; s < grads.cols(); s++) {
+            TensorView<const T> real(grads.col(s).data(), dep, out_h, out_w);
+            TensorView<const T> in(cache.col(s).data(), dep, in_h, in_w);
+            TensorView<T> ret(out.col(s).data(), dep, in_h, in_w);
 
-        std::vector<Eigen::MatrixXd> ret;
-        for (int z = 0; z < dep; z++) {
-            ret.push_back(Eigen::MatrixXd{ in_h, in_w });
-            for (int i = 0; i < in_h; i += scan_h) {
-                for (int j = 0; j < in_w; j += scan_w) {
-                    int bx = std::min(scan_h, (int)in_h - i), by = std::min(scan_w, (int)in_w - j);
-                    ret.back().block(i, j, bx, by) = PoolDeriv(cache[z].block(i, j, bx, by), real[z](i / scan_h, j / scan_w));
+            for (int z = 0; z < dep; z++) {
+                if (kernel == POOL_AVG) {
+                    AvgBackward(real[z], ret[z]);
+                    continue;
+                }
+                for (int i = 0; i < in_h; i += scan_h) {
+                    for (int j = 0; j < in_w; j += scan_w) {
+                        int bx = std::min(scan_h, in_h - i), by = std::min(scan_w, in_w - j);
+                        ret[z].block(i, j, bx, by) = PoolDeriv(in[z].block(i, j, bx, by), real[z](i / scan_h, j / scan_w));
+                    }
                 }
             }
         }
 
-        return ThreeDToVec(ret);
+        return out;
     }
 
-    std::istream& PoolL::Read(std::istream& istr) {
-        cache.clear();
+    template <typename T> std::istream& BasicPoolL<T>::Read(std::istream& istr) {
+        cache.resize(0, 0);
+        argmax.resize(0, 0);
         istr >> dep >> in_h >> in_w >> scan_h >> scan_w >> PoolFunc >> PoolDeriv;
+        if (in_h < 1 || in_w < 1 || scan_h < 1 || scan_w < 1) throw Exception("PoolL::Read: Input and scan sizes in the data must be positive!");
         CalcOutSizes();
+        FindKernel();
 
         return istr;
     }
 
-    std::ostream& PoolL::Write(std::ostream& ostr) const {
+    template <typename T> std::ostream& BasicPoolL<T>::Write(std::ostream& ostr) const {
         ostr << id << '\n' << dep << ' ' << in_h << ' ' << in_w << '\n' << scan_h << ' ' << scan_w << '\n' << PoolFunc << PoolDeriv << '\n';
 
         return ostr;
     }
+
+    template <typename T> void BasicPoolL<T>::ReadBinary(BinaryReader& reader) {
+        cache.resize(0, 0);
+        argmax.resize(0, 0);
+        dep = reader.GetSize();
+        in_h = reader.GetSize();
+        in_w = reader.GetSize();
+        scan_h = reader.GetSize();
+        scan_w = reader.GetSize();
+        reader.GetFunc(PoolFunc);
+        reader.GetFunc(PoolDeriv);
+        if (in_h < 1 || in_w < 1 || scan_h < 1 || scan_w < 1) throw Exception("PoolL::ReadBinary: Input and scan sizes in the data must be positive!");
+        CalcOutSizes();
+        FindKernel();
+    }
+    template <typename T> void BasicPoolL<T>::WriteBinary(BinaryWriter& writer) const {
+        for (int v : { dep, in_h, in_w, scan_h, scan_w }) writer.Put<int32_t>(v);
+        writer.PutFunc(PoolFunc);
+        writer.PutFunc(PoolDeriv);
+    }
+
+    template class BasicPoolL<float>;
+    template class BasicPoolL<double>;
 }
\ No newline at end of file
@@ -4,19 +4,38 @@
 #include "layer.h"
 
 namespace NNet {
-    class PoolL : public LayerCRTP<PoolL> {
+    template <typename T> class BasicPoolL : public LayerCRTP<BasicPoolL<T>, T> {
     private:
+        using BasicLayer<T>::id;
+
         int dep, in_h, in_w, scan_h, scan_w, out_h, out_w;
-        d_F_md PoolFunc;
-        md_F_md_d PoolDeriv;
+        s_F_m<T> PoolFunc;
+        m_F_m_s<T> PoolDeriv;
+
+        ///MaxPool and AvgPool (with their own derivatives) run on whole channels instead of calling PoolFunc per window
+        enum PoolKernel{POOL_CUSTOM, POOL_MAX, POOL_AVG} kernel;
 
-        std::vector<Eigen::MatrixXd> cache;
+        ///Input of the last batch for custom pools, flat input index of every max for max pools
+        Eigen::MatrixX<T> cache;
+        Eigen::MatrixXi argmax;
 
         void CalcOutSizes();
+        void FindKernel();
+
+        ///Rows and columns covered by the windows of output row r and output column c
+        int WindowHeight(int r) const;
+        int WindowWidth(int c) const;
+
+        void MaxForward(Eigen::Map<const MatrixRX<T>> in, Eigen::Map<MatrixRX<T>> out, int* args, int offset) const;
+        void AvgForward(Eigen::Map<const MatrixRX<T>> in, Eigen::Map<MatrixRX<T>> out) const;
+        void AvgBackward(Eigen::Map<const MatrixRX<T>> grads, Eigen::Map<MatrixRX<T>> out) const;
+        ///Pools every column of in into ret, max pools also record their argmax when args isn't null
+        void Pool(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& ret, Eigen::MatrixXi* args) const;
     public:
-        PoolL(int in_h, int in_w, int scan_h, int scan_w, d_F_md PoolFunc, md_F_md_d PoolDeriv);
-        PoolL(const PoolL& other);
-        PoolL(std::istream& istr);
+        BasicPoolL(int in_h, int in_w, int scan_h, int scan_w, s_F_m<T> PoolFunc, m_F_m_s<T> PoolDeriv);
+        BasicPoolL(const BasicPoolL& other);
+        BasicPoolL(std::istream& istr);
+        BasicPoolL(BinaryReader& reader);
 
         int InHeight() const;
         int InWidth() const;
@@ -25,18 +44,25 @@ namespace NNet {
         int ScanHeight() const;
         int ScanWidth() const;
 
-        d_F_md GetPoolFunc() const;
-        md_F_md_d GetPoolDeriv() const;
+        s_F_m<T> GetPoolFunc() const;
+        m_F_m_s<T> GetPoolDeriv() const;
 
         void InitParams(d_F GenFunc) override;
         void SetInputSize(int input_sz) override;
 
         int OutSize() const override;
 
-        Eigen::VectorXd Forward(const Eigen::VectorXd& in) override;
-        Eigen::VectorXd Backward(const Eigen::VectorXd& grads) override;
+        Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>& in) override;
+        Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>& grads) override;
+        void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const override;
 
         std::istream& Read(std::istream& istr) override;
         std::ostream& Write(std::ostream& ostr) const override;
+
+        void ReadBinary(BinaryReader& reader) override;
+        void WriteBinary(BinaryWriter& writer) const override;
     };
+
+    typedef BasicPoolL<double> PoolL;
+    typedef BasicPoolL<float> PoolLf;
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "quantize.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace NNet {
+	///Largest int8 magnitude used, -128 is left out so that the range is symmetric
+	const int QMAX = 127;
+
+	int32_t DotInt8(const int8_t* a, const int8_t* b, int n) {
+		int k = 0;
+		int32_t ret = 0;
+#if defined(__AVX2__)
+		// sign extension to int16 and pairwise multiply-adds into int32, 16 products per step
+		__m256i acc = _mm256_setzero_si256();
+		for (; k + 16 <= n; k += 16) {
+			__m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k)));
+			__m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k)));
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+		}
+		__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		ret = _mm_cvtsi128_si32(sum);
+#elif defined(__SSE2__) || defined(_M_X64)
+		// SSE2 has no int8 sign extension, interleaving with zeros and shifting right arithmetically does the same
+		__m128i acc = _mm_setzero_si128();
+		for (; k + 16 <= n; k += 16) {
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k));
+			__m128i zero = _mm_setzero_si128();
+			__m128i alo = _mm_srai_epi16(_mm_unpacklo_epi8(zero, va), 8), ahi = _mm_srai_epi16(_mm_unpackhi_epi8(zero, va), 8);
+			__m128i blo = _mm_srai_epi16(_mm_unpacklo_epi8(zero, vb), 8), bhi = _mm_srai_epi16(_mm_unpackhi_epi8(zero, vb), 8);
+			acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(alo, blo), _mm_madd_epi16(ahi, bhi)));
+		}
+		__m128i sum = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		ret = _mm_cvtsi128_si32(sum);
+#endif
+		// tail, and the whole product on targets without SSE2
+		for (; k < n; k++) ret += (int32_t)a[k] * b[k];
+		return ret;
+	}
+
+	///Rounds x / scale to the nearest int8 in [-QMAX, QMAX]
+	template <typename T> static int8_t QuantizeValue(T x, T scale) {
+		long q = std::lround(x / scale);
+		return (int8_t)std::max<long>(-QMAX, std::min<long>(QMAX, q));
+	}
+
+	// --------------- QuantDenseL --------------- //
+
+	template <typename T> QuantDenseL<T>::QuantDenseL(const BasicDenseL<T>& layer, T max_input) {
+		Eigen::MatrixX<T> w = layer.Weights();
+		in_sz = w.cols();
+		out_sz = w.rows();
+		stride = (in_sz + 31) / 32 * 32;
+
+		// all-zero rows and inputs keep a scale of 1 so that nothing is divided by 0
+		in_scale = max_input > 0 ? max_input / QMAX : T(1);
+
+		weights.assign((size_t)out_sz * stride, 0);
+		row_scales.resize(out_sz);
+		for (int i = 0; i < out_sz; i++) {
+			T m = w.row(i).cwiseAbs().maxCoeff();
+			row_scales(i) = m > 0 ? m / QMAX : T(1);
+			for (int j = 0; j < in_sz; j++) weights[(size_t)i * stride + j] = QuantizeValue(w(i, j), row_scales(i));
+		}
+
+		// the scale of the input is folded into the row scales
+		row_scales *= in_scale;
+	}
+
+	template <typename T> int QuantDenseL<T>::InSize() const { return in_sz; }
+	template <typename T> int QuantDenseL<T>::OutSize() const { return out_sz; }
+
+	template <typename T> size_t QuantDenseL<T>::WeightBytes() const { return weights.size() + row_scales.size() * sizeof(T); }
+
+	template <typename T> Eigen::MatrixX<T> QuantDenseL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) const {
+		if (in.rows() != in_sz) throw Exception("QuantDenseL::ForwardBatch: Input sizes don't match");
+
+		// the padding past in_sz stays zero for every sample
+		std::vector<int8_t> qin(stride, 0);
+		Eigen::MatrixX<T> ret(out_sz, in.cols());
+		for (int s = 0; s < in.cols(); s++) {
+			Eigen::Map<Eigen::Matrix<int8_t, Eigen::Dynamic, 1>>(qin.data(), in_sz) =
+				(in.col(s).array() / in_scale).round().max(T(-QMAX)).min(T(QMAX)).template cast<int8_t>();
+			for (int i = 0; i < out_sz; i++) ret(i, s) = DotInt8(weights.data() + (size_t)i * stride, qin.data(), stride) * row_scales(i);
+		}
+
+		return ret;
+	}
+
+	// --------------- QuantizedNet --------------- //
+
+	template <typename T> BasicQuantizedNet<T>::BasicQuantizedNet(const BasicNeuralNet<T>& net, const Eigen::MatrixX<T>& calibration) :
+		in_sz(net.InSize()), out_sz(net.OutSize())
+	{
+		if (calibration.rows() != in_sz || calibration.cols() == 0) throw Exception("QuantizedNet::QuantizedNet: Calibration samples are not the right size!");
+
+		// the calibration set is passed through the original layers to find the input range of every DenseL
+		std::vector<std::unique_ptr<BasicLayer<T>>> copies;
+		for (auto& layer : net.LayersCopy()) copies.emplace_back(layer);
+
+		Eigen::MatrixX<T> x = calibration;
+		for (auto& copy : copies) {
+			auto dl = dynamic_cast<BasicDenseL<T>*>(copy.get());
+
+			Eigen::MatrixX<T> next = copy->ForwardBatch(x);
+			if (dl) {
+				dense.emplace_back(new QuantDenseL<T>(*dl, x.cwiseAbs().maxCoeff()));
+				layers.emplace_back();
+			}
+			else {
+				dense.emplace_back();
+				layers.push_back(std::move(copy));
+			}
+			x = std::move(next);
+		}
+	}
+
+	template <typename T> int BasicQuantizedNet<T>::InSize() const { return in_sz; }
+	template <typename T> int BasicQuantizedNet<T>::OutSize() const { return out_sz; }
+
+	template <typename T> size_t BasicQuantizedNet<T>::OriginalWeightBytes() const {
+		size_t ret = 0;
+		for (auto& d : dense) if (d) ret += (size_t)d->OutSize() * d->InSize() * sizeof(T);
+		return ret;
+	}
+	template <typename T> size_t BasicQuantizedNet<T>::WeightBytes() const {
+		size_t ret = 0;
+		for (auto& d : dense) if (d) ret += d->WeightBytes();
+		return ret;
+	}
+
+	template <typename T> Eigen::VectorX<T> BasicQuantizedNet<T>::Query(const Eigen::VectorX<T>& in) const {
+		if (in.size() != in_sz) throw Exception("QuantizedNet::Query: Rececived input vector is not the right size!");
+		return QueryBatch(in);
+	}
+	template <typename T> Eigen::MatrixX<T> BasicQuantizedNet<T>::QueryBatch(const Eigen::MatrixX<T>& in) const {
+		if (in.rows() != in_sz) throw Exception("QuantizedNet::QueryBatch: Rececived input matrix is not the right size!");
+
+		Eigen::MatrixX<T> ret = in, next;
+		std::vector<LayerWorkspace<T>> ws(layers.size());
+		for (int i = 0; i < layers.size(); i++) {
+			if (dense[i]) ret = dense[i]->ForwardBatch(ret);
+			else {
+				layers[i]->Infer(ret, next, ws[i]);
+				ret.swap(next);
+			}
+		}
+
+		return ret;
+	}
+
+	// --------------- Report --------------- //
+
+	template <typename T> static bool Correct(const Eigen::VectorX<T>& out, const Eigen::VectorX<T>& target) {
+		if (out.size() == 1) return (out(0) >= 0) == (target(0) >= 0);
+
+		Eigen::Index a, b;
+		out.maxCoeff(&a);
+		target.maxCoeff(&b);
+		return a == b;
+	}
+
+	template <typename T> QuantReport CompareQuantized(BasicNeuralNet<T>& net, const BasicQuantizedNet<T>& qnet, const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target) {
+		if (target.rows() != net.OutSize() || target.cols() != in.cols()) throw Exception("NNet::CompareQuantized: Target matrix is not the right size!");
+
+		Eigen::MatrixX<T> ref = net.QueryBatch(in), quant = qnet.QueryBatch(in);
+
+		QuantReport report{ (int)in.cols(), 0, 0, 0, 0, qnet.OriginalWeightBytes(), qnet.WeightBytes() };
+		for (int s = 0; s < in.cols(); s++) {
+			report.accuracy += Correct<T>(ref.col(s), target.col(s));
+			report.quant_accuracy += Correct<T>(quant.col(s), target.col(s));
+		}
+		if (report.samples) {
+			Eigen::MatrixX<T> diff = (ref - quant).cwiseAbs();
+			report.accuracy /= report.samples;
+			report.quant_accuracy /= report.samples;
+			report.max_abs_diff = diff.maxCoeff();
+			report.mean_abs_diff = diff.mean();
+		}
+
+		return report;
+	}
+
+	std::ostream& operator<<(std::ostream& ostr, const QuantReport& report) {
+		ostr << "samples: " << report.samples << '\n'
+			<< "accuracy: " << report.accuracy << " -> " << report.quant_accuracy
+			<< " (delta " << report.quant_accuracy - report.accuracy << ")\n"
+			<< "output difference: max " << report.max_abs_diff << ", mean " << report.mean_abs_diff << '\n'
+			<< "DenseL weights: " << report.weight_bytes << " -> " << report.quant_weight_bytes << " bytes\n";
+		return ostr;
+	}
+
+	template class QuantDenseL<float>;
+	template class QuantDenseL<double>;
+	template class BasicQuantizedNet<float>;
+	template class BasicQuantizedNet<double>;
+
+	template QuantReport CompareQuantized<float>(BasicNeuralNet<float>&, const BasicQuantizedNet<float>&, const Eigen::MatrixXf&, const Eigen::MatrixXf&);
+	template QuantReport CompareQuantized<double>(BasicNeuralNet<double>&, const BasicQuantizedNet<double>&, const Eigen::MatrixXd&, const Eigen::MatrixXd&);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "neural_net.h"
+#include <cstdint>
+#include <memory>
+
+namespace NNet {
+	///Dot product of n int8 values accumulated in int32, uses AVX2 when the library is built with it and SSE2 otherwise
+	int32_t DotInt8(const int8_t* a, const int8_t* b, int n);
+
+	///Inference-only int8 copy of a DenseL
+	///every weight row is scaled by its own largest magnitude, inputs by a fixed scale found during calibration;
+	///products are accumulated in int32 and scaled back to T once per output
+	template <typename T> class QuantDenseL {
+	private:
+		int in_sz, out_sz;
+		///Row length padded with zeros to a multiple of 32, so the vector kernel never needs a scalar tail
+		int stride;
+		std::vector<int8_t> weights;
+		Eigen::VectorX<T> row_scales;
+		T in_scale;
+	public:
+		///max_input is the largest input magnitude seen during calibration, larger inputs are clipped
+		QuantDenseL(const BasicDenseL<T>& layer, T max_input);
+
+		int InSize() const;
+		int OutSize() const;
+
+		///Bytes actually held: the padded int8 rows and the row scales
+		size_t WeightBytes() const;
+
+		///Keeps no state between calls, so one layer can serve several threads
+		Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>& in) const;
+	};
+
+	///Post-training quantized form of a NeuralNet, only supports queries
+	///DenseL layers run through QuantDenseL, all other layers are copies of the original ones
+	template <typename T> class BasicQuantizedNet {
+	private:
+		int in_sz, out_sz;
+		///Exactly one of layers[i] and dense[i] is set
+		std::vector<std::unique_ptr<BasicLayer<T>>> layers;
+		std::vector<std::unique_ptr<QuantDenseL<T>>> dense;
+	public:
+		///calibration holds representative inputs (one sample per column), they set the input scale of every DenseL
+		BasicQuantizedNet(const BasicNeuralNet<T>& net, const Eigen::MatrixX<T>& calibration);
+
+		int InSize() const;
+		int OutSize() const;
+
+		///Bytes of DenseL weights before and after quantization
+		size_t OriginalWeightBytes() const;
+		size_t WeightBytes() const;
+
+		///const and thread-safe, the other layers run through Layer::Infer with workspaces local to the call
+		Eigen::VectorX<T> Query(const Eigen::VectorX<T>& in) const;
+		Eigen::MatrixX<T> QueryBatch(const Eigen::MatrixX<T>& in) const;
+	};
+
+	typedef BasicQuantizedNet<double> QuantizedNet;
+	typedef BasicQuantizedNet<float> QuantizedNetf;
+
+	///Accuracy of a quantized net against the net it was made from
+	///a sample counts as correct when the largest output matches the largest target, for single outputs the signs are compared
+	struct QuantReport {
+		int samples;
+		double accuracy, quant_accuracy;
+		double max_abs_diff, mean_abs_diff;
+		size_t weight_bytes, quant_weight_bytes;
+	};
+
+	///Runs the samples (one per column) through both nets
+	template <typename T> QuantReport CompareQuantized(BasicNeuralNet<T>& net, const BasicQuantizedNet<T>& qnet, const Eigen::MatrixX<T>& in, const Eigen::MatrixX<T>& target);
+
+	std::ostream& operator<<(std::ostream& ostr, const QuantReport& report);
+}
@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "request_batcher.h"
+#include <algorithm>
+
+namespace NNet {
+	std::ostream& operator<<(std::ostream& ostr, const BatcherStats& stats) {
+		ostr << "requests: " << stats.requests << " in " << stats.batches << " batches, " << stats.mean_batch << " per batch\n"
+			<< "queueing delay: " << stats.mean_delay * 1e3 << " ms mean, " << stats.max_delay * 1e3 << " ms max\n"
+			<< "compute: " << stats.compute_seconds << " s\n";
+		return ostr;
+	}
+
+	template <typename T> BasicRequestBatcher<T>::BasicRequestBatcher(const BasicNeuralNet<T>& net, const BatcherOptions& options) :
+		net(net), options(options), stop(false)
+	{
+		if (options.max_batch <= 0 || options.max_delay < 0 || options.workers <= 0) throw Exception("RequestBatcher: Invalid options!");
+		ResetStats();
+
+		for (int i = 0; i < options.workers; i++) workers.emplace_back(&BasicRequestBatcher::Run, this);
+	}
+
+	template <typename T> BasicRequestBatcher<T>::~BasicRequestBatcher() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stop = true;
+		}
+		cv.notify_all();
+		for (auto& worker : workers) worker.join();
+	}
+
+	template <typename T> void BasicRequestBatcher<T>::Run() {
+		auto max_delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.max_delay));
+		BasicWorkspace<T> ws;
+		Eigen::MatrixX<T> in;
+		std::vector<Request> batch;
+		std::vector<Eigen::VectorX<T>> results;
+
+		std::unique_lock<std::mutex> lock(mtx);
+		while (true) {
+			cv.wait(lock, [this] { return !queue.empty() || stop; });
+			if (queue.empty()) return;
+
+			// hold the batch open until it is full or its oldest request is due, another worker may take it meanwhile
+			Clock::time_point deadline = queue.front().arrived + max_delay;
+			cv.wait_until(lock, deadline, [this] { return queue.size() >= (size_t)options.max_batch || queue.empty() || stop; });
+			if (queue.empty()) continue;
+
+			int n = (int)std::min(queue.size(), (size_t)options.max_batch);
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < n; i++) {
+				double delay = std::chrono::duration<double>(start - queue.front().arrived).count();
+				total_delay += delay;
+				stats.max_delay = std::max(stats.max_delay, delay);
+
+				batch.push_back(std::move(queue.front()));
+				queue.pop_front();
+			}
+			stats.requests += n;
+			stats.batches++;
+			stats.batch_sizes[n]++;
+			if (!queue.empty()) cv.notify_one();
+			lock.unlock();
+
+			std::exception_ptr err;
+			double compute = 0.;
+			try {
+				in.resize(net.InSize(), n);
+				for (int i = 0; i < n; i++) in.col(i) = batch[i].in;
+
+				const Eigen::MatrixX<T>& out = net.Infer(in, ws);
+				compute = std::chrono::duration<double>(Clock::now() - start).count();
+				results.resize(n);
+				for (int i = 0; i < n; i++) results[i] = out.col(i);
+			}
+			catch (...) { err = std::current_exception(); }
+
+			// the promises are only touched once every result exists, so each one is satisfied exactly once
+			for (int i = 0; i < n; i++) {
+				if (err) batch[i].result.set_exception(err);
+				else batch[i].result.set_value(std::move(results[i]));
+			}
+			batch.clear();
+
+			lock.lock();
+			stats.compute_seconds += compute;
+		}
+	}
+
+	template <typename T> std::future<Eigen::VectorX<T>> BasicRequestBatcher<T>::Submit(Eigen::VectorX<T> in) {
+		if (in.size() != net.InSize()) throw Exception("RequestBatcher::Submit: Rececived input vector is not the right size!");
+
+		std::future<Eigen::VectorX<T>> ret;
+		size_t waiting;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			queue.push_back({ std::move(in), {}, Clock::now() });
+			ret = queue.back().result.get_future();
+			waiting = queue.size();
+		}
+		// a worker only has to wake up to start the deadline of a new batch or to run a full one
+		if (waiting == 1 || waiting >= (size_t)options.max_batch) cv.notify_one();
+
+		return ret;
+	}
+	template <typename T> Eigen::VectorX<T> BasicRequestBatcher<T>::Query(const Eigen::VectorX<T>& in) {
+		return Submit(in).get();
+	}
+
+	template <typename T> const BatcherOptions& BasicRequestBatcher<T>::Options() const { return options; }
+
+	template <typename T> BatcherStats BasicRequestBatcher<T>::Stats() {
+		std::lock_guard<std::mutex> lock(mtx);
+		BatcherStats ret = stats;
+		ret.mean_batch = stats.batches ? (double)stats.requests / stats.batches : 0.;
+		ret.mean_delay = stats.requests ? total_delay / stats.requests : 0.;
+		return ret;
+	}
+	template <typename T> void BasicRequestBatcher<T>::ResetStats() {
+		std::lock_guard<std::mutex> lock(mtx);
+		stats = BatcherStats{ 0, 0, std::vector<size_t>(options.max_batch + 1, 0), 0., 0., 0., 0. };
+		total_delay = 0.;
+	}
+
+	template class BasicRequestBatcher<float>;
+	template class BasicRequestBatcher<double>;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "neural_net.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace NNet {
+	struct BatcherOptions {
+		///Largest number of requests run in one forward pass
+		int max_batch = 32;
+		///Longest time in seconds the oldest waiting request is held back to fill its batch, 0 runs whatever is queued at once
+		double max_delay = 0.001;
+		///Batches run concurrently on this many threads, each with its own Workspace
+		int workers = 1;
+	};
+
+	///Counters since construction or the last ResetStats
+	struct BatcherStats {
+		size_t requests, batches;
+		///batch_sizes[n] is the number of batches that held n requests
+		std::vector<size_t> batch_sizes;
+		double mean_batch;
+		///Queueing delay from Submit until the forward pass of the request starts, in seconds
+		double mean_delay, max_delay;
+		///Time spent in forward passes (including copying the inputs into the batch), in seconds
+		double compute_seconds;
+	};
+
+	std::ostream& operator<<(std::ostream& ostr, const BatcherStats& stats);
+
+	///Groups single-sample requests from many threads into batches for one forward pass each (dynamic batching)
+	///a batch starts once max_batch requests are waiting or its oldest request waited max_delay, whichever comes first
+	///the net is only used through NeuralNet::Infer, it has to outlive the batcher and must not be trained while it lives
+	template <typename T> class BasicRequestBatcher {
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Request {
+			Eigen::VectorX<T> in;
+			std::promise<Eigen::VectorX<T>> result;
+			Clock::time_point arrived;
+		};
+
+		const BasicNeuralNet<T>& net;
+		BatcherOptions options;
+
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::deque<Request> queue;
+		bool stop;
+
+		BatcherStats stats;
+		double total_delay;
+
+		std::vector<std::thread> workers;
+
+		void Run();
+	public:
+		BasicRequestBatcher(const BasicNeuralNet<T>& net, const BatcherOptions& options = {});
+		BasicRequestBatcher(const BasicRequestBatcher&) = delete;
+		BasicRequestBatcher& operator=(const BasicRequestBatcher&) = delete;
+		///Answers every request that is still queued before returning
+		~BasicRequestBatcher();
+
+		///Queues one sample, the future gets the output of the net or the exception thrown while computing it
+		std::future<Eigen::VectorX<T>> Submit(Eigen::VectorX<T> in);
+		///Blocking shorthand for Submit(in).get()
+		Eigen::VectorX<T> Query(const Eigen::VectorX<T>& in);
+
+		const BatcherOptions& Options() const;
+
+		BatcherStats Stats();
+		void ResetStats();
+	};
+
+	typedef BasicRequestBatcher<double> RequestBatcher;
+	typedef BasicRequestBatcher<float> RequestBatcherf;
+}
@@ -0,0 +1,228 @@
+#include "pch.h"
+#include "sep_conv_layer.h"
+
+namespace NNet {
+	template <typename T> void BasicSepConvL<T>::CalcOutSizes() {
+		if (pad == SAME) { out_h = in_h; out_w = in_w; }
+		else if (pad == VALID) { out_h = in_h - kernel_h + 1; out_w = in_w - kernel_w + 1; }
+	}
+
+	template <typename T> BasicSepConvL<T>::BasicSepConvL(T lrate_, int input_h, int input_w, int output_d, int kernel_h, int kernel_w, Padding pad) :
+		in_h(input_h), in_w(input_w), out_d(output_d), kernel_h(kernel_h), kernel_w(kernel_w), pad(pad)
+	{
+		lrate = lrate_;
+		id = "SepConv";
+	}
+	template <typename T> BasicSepConvL<T>::BasicSepConvL(const BasicSepConvL& other) {
+		in_d = other.InDepth();
+		in_h = other.InHeight();
+		in_w = other.InWidth();
+		out_d = other.OutDepth();
+
+		kernels = other.Kernels();
+		kernel_h = kernels.Height();
+		kernel_w = kernels.Width();
+		pointwise = other.Pointwise();
+
+		lrate = other.LRate();
+		pad = other.GetPadding();
+
+		CalcOutSizes();
+
+		id = "SepConv";
+	}
+	template <typename T> BasicSepConvL<T>::BasicSepConvL(std::istream& istr) {
+		id = "SepConv";
+		Read(istr);
+	}
+	template <typename T> BasicSepConvL<T>::BasicSepConvL(BinaryReader& reader) {
+		id = "SepConv";
+		ReadBinary(reader);
+	}
+
+	template <typename T> int BasicSepConvL<T>::InDepth() const { return in_d; }
+	template <typename T> int BasicSepConvL<T>::InHeight() const { return in_h; }
+	template <typename T> int BasicSepConvL<T>::InWidth() const { return in_w; }
+	template <typename T> int BasicSepConvL<T>::OutDepth() const { return out_d; }
+
+	template <typename T> Padding BasicSepConvL<T>::GetPadding() const { return pad; }
+	template <typename T> BasicTensor<T> BasicSepConvL<T>::Kernels() const { return kernels; }
+	template <typename T> Eigen::MatrixX<T> BasicSepConvL<T>::Pointwise() const { return pointwise; }
+
+	template <typename T> ConvShape BasicSepConvL<T>::Shape() const {
+		return MakeConvShape(in_d, in_h, in_w, 1, kernel_h, kernel_w, out_h, out_w, pad);
+	}
+
+	template <typename T> void BasicSepConvL<T>::SetInputSize(int in_sz) {
+		if (in_sz % (in_h * in_w)) throw Exception("SepConvL::SetInputSize: Make sure total input size is divisible by the product of input height and width!");
+		in_d = in_sz / (in_h * in_w);
+		CalcOutSizes();
+	}
+	template <typename T> void BasicSepConvL<T>::InitParams(d_F GenFunc) {
+		kernels = BasicTensor<T>(in_d, kernel_h, kernel_w);
+		for (int i = 0; i < in_d; i++) {
+			for (int j = 0; j < kernel_h; j++) {
+				for (int k = 0; k < kernel_w; k++) kernels[i](j, k) = GenFunc();
+			}
+		}
+
+		pointwise = Eigen::MatrixX<T>(out_d, in_d);
+		for (int i = 0; i < out_d; i++) {
+			for (int j = 0; j < in_d; j++) pointwise(i, j) = GenFunc();
+		}
+	}
+	template <typename T> int BasicSepConvL<T>::OutSize() const {
+		return out_d * out_h * out_w;
+	}
+
+	// channel i of every sample is unrolled into rows i * patch ... (i + 1) * patch - 1 of cols, so the depthwise
+	// stage is one (1 x patch) by (patch x area * batch size) product per channel and the pointwise stage one GEMM
+
+	template <typename T> void BasicSepConvL<T>::Forward(const Eigen::MatrixX<T>& in, MatrixRX<T>& cols, MatrixRX<T>& depth, Eigen::MatrixX<T>& out) const {
+		ConvShape shape = Shape();
+		int area = out_h * out_w, patch = kernel_h * kernel_w;
+
+		cols.resize(in_d * patch, (std::ptrdiff_t)area * in.cols());
+		for (int s = 0; s < in.cols(); s++) {
+			TensorView<const T> sample(in.col(s).data(), in_d, in_h, in_w);
+			for (int i = 0; i < in_d; i++) Im2col<T>(sample[i], shape, cols.block(i * patch, s * area, patch, area));
+		}
+
+		depth.resize(in_d, cols.cols());
+		for (int i = 0; i < in_d; i++) {
+			Eigen::Map<const Eigen::RowVectorX<T>> ker(kernels[i].data(), patch);
+			depth.row(i).noalias() = ker * cols.middleRows(i * patch, patch);
+		}
+
+		MatrixRX<T> res = pointwise * depth;
+
+		out.resize(OutSize(), in.cols());
+		for (int s = 0; s < in.cols(); s++) {
+			for (int o = 0; o < out_d; o++) out.col(s).segment(o * area, area) = res.row(o).segment(s * area, area).transpose();
+		}
+	}
+
+	template <typename T> Eigen::MatrixX<T> BasicSepConvL<T>::ForwardBatch(const Eigen::MatrixX<T>& in) {
+		if (in.rows() != in_d * in_h * in_w) throw Exception("SepConvL::ForwardBatch: Input size doesn't match!");
+
+		Eigen::MatrixX<T> out;
+		Forward(in, cols, depth, out);
+		return out;
+	}
+	template <typename T> void BasicSepConvL<T>::Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const {
+		if (in.rows() != in_d * in_h * in_w) throw Exception("SepConvL::Infer: Input size doesn't match!");
+		Forward(in, ws.cols, ws.depth, out);
+	}
+	template <typename T> Eigen::MatrixX<T> BasicSepConvL<T>::BackwardBatch(const Eigen::MatrixX<T>& grads) {
+		if (grads.rows() != out_d * out_h * out_w) throw Exception("SepConvL::BackwardBatch: Gradient list is not the right size!");
+
+		int area = out_h * out_w, patch = kernel_h * kernel_w;
+		if (depth.cols() != (std::ptrdiff_t)area * grads.cols()) throw Exception("SepConvL::BackwardBatch: Batch size doesn't match the previous Forward!");
+
+		MatrixRX<T> g(out_d, depth.cols());
+		for (int s = 0; s < grads.cols(); s++) {
+			for (int o = 0; o < out_d; o++) g.row(o).segment(s * area, area) = grads.col(s).segment(o * area, area).transpose();
+		}
+
+		T step = lrate / T(grads.cols());
+		MatrixRX<T> depth_grads = pointwise.transpose() * g;
+		pointwise.noalias() -= step * g * depth.transpose();
+
+		// the patch gradients of a channel are the outer product of its kernel with its depthwise gradients
+		MatrixRX<T> dcols(patch, depth.cols());
+		ConvShape shape = Shape();
+		Eigen::MatrixX<T> out = Eigen::MatrixX<T>::Zero(in_d * in_h * in_w, grads.cols());
+		for (int i = 0; i < in_d; i++) {
+			Eigen::Map<Eigen::RowVectorX<T>> ker(kernels[i].data(), patch);
+			dcols.noalias() = ker.transpose() * depth_grads.row(i);
+			ker.noalias() -= step * depth_grads.row(i) * cols.middleRows(i * patch, patch).transpose();
+
+			for (int s = 0; s < grads.cols(); s++) {
+				Col2im<T>(dcols.middleCols(s * area, area), shape, TensorView<T>(out.col(s).data(), in_d, in_h, in_w)[i]);
+			}
+		}
+
+		return out;
+	}
+
+	template <typename T> std::vector<Eigen::Map<Eigen::VectorX<T>>> BasicSepConvL<T>::Params() {
+		return { Eigen::Map<Eigen::VectorX<T>>(kernels.Data(), kernels.Flat().size()), Eigen::Map<Eigen::VectorX<T>>(pointwise.data(), pointwise.size()) };
+	}
+
+	template <typename T> std::istream& BasicSepConvL<T>::Read(std::istream& istr) {
+		istr >> in_d >> in_h >> in_w >> out_d >> kernel_h >> kernel_w;
+		int a;
+		istr >> a;
+		if (a < 0 || a >= 2) throw Exception("SepConvL::Read: Invalid data given to read from stream!");
+		pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("SepConvL::Read: Input and kernel sizes in the data don't fit together!");
+		istr >> lrate;
+
+		CalcOutSizes();
+		cols.resize(0, 0);
+		depth.resize(0, 0);
+
+		kernels = BasicTensor<T>(in_d, kernel_h, kernel_w);
+		for (int i = 0; i < in_d; i++) {
+			for (int j = 0; j < kernel_h; j++) {
+				for (int k = 0; k < kernel_w; k++) istr >> kernels[i](j, k);
+			}
+		}
+
+		pointwise = Eigen::MatrixX<T>(out_d, in_d);
+		for (int i = 0; i < out_d; i++) {
+			for (int j = 0; j < in_d; j++) istr >> pointwise(i, j);
+		}
+
+		return istr;
+	}
+
+	template <typename T> std::ostream& BasicSepConvL<T>::Write(std::ostream& ostr) const {
+		ostr << id << '\n';
+		ostr << in_d << ' ' << in_h << ' ' << in_w << '\n' << out_d << ' ' << kernel_h << ' ' << kernel_w << '\n' << pad << '\n' << lrate << '\n';
+
+		for (int i = 0; i < in_d; i++) ostr << kernels[i] << '\n';
+		ostr << pointwise << '\n';
+
+		return ostr;
+	}
+
+	template <typename T> void BasicSepConvL<T>::ReadBinary(BinaryReader& reader) {
+		in_d = reader.GetSize();
+		in_h = reader.GetSize();
+		in_w = reader.GetSize();
+		out_d = reader.GetSize();
+		kernel_h = reader.GetSize();
+		kernel_w = reader.GetSize();
+		int a = reader.Get<int32_t>();
+		if (a < 0 || a >= 2) throw Exception("SepConvL::ReadBinary: Invalid data given to read from!");
+		pad = static_cast<Padding>(a);
+		// a zero size or a VALID kernel larger than its input leaves no valid output size
+		if (in_h < 1 || in_w < 1 || kernel_h < 1 || kernel_w < 1 || (pad == VALID && (kernel_h > in_h || kernel_w > in_w)))
+			throw Exception("SepConvL::ReadBinary: Input and kernel sizes in the data don't fit together!");
+		lrate = (T)reader.Get<double>();
+		reader.BlobSize({ in_d, kernel_h, kernel_w });
+
+		CalcOutSizes();
+		cols.resize(0, 0);
+		depth.resize(0, 0);
+
+		kernels = BasicTensor<T>(in_d, kernel_h, kernel_w);
+		reader.GetBlob(kernels.Data(), kernels.Flat().size());
+
+		reader.BlobSize({ out_d, in_d });
+		pointwise = Eigen::MatrixX<T>(out_d, in_d);
+		reader.GetBlob(pointwise.data(), pointwise.size());
+	}
+	template <typename T> void BasicSepConvL<T>::WriteBinary(BinaryWriter& writer) const {
+		for (int v : { in_d, in_h, in_w, out_d, kernel_h, kernel_w, (int)pad }) writer.Put<int32_t>(v);
+		writer.Put<double>(lrate);
+		writer.PutBlob(kernels.Data(), kernels.Flat().size());
+		writer.PutBlob(pointwise.data(), pointwise.size());
+	}
+
+	template class BasicSepConvL<float>;
+	template class BasicSepConvL<double>;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "layer.h"
+#include "helpers.h"
+#include "conv_engine.h"
+
+namespace NNet {
+	///Depthwise-separable convolution: every input channel is convolved with its own kernel (depthwise),
+	///then the out_d output channels are weighted sums of the depthwise channels (1x1 pointwise)
+	///costs kernel_h * kernel_w + out_d multiplications per input pixel instead of kernel_h * kernel_w * out_d
+	template <typename T> class BasicSepConvL : public LayerCRTP<BasicSepConvL<T>, T> {
+	private:
+		using BasicLayer<T>::lrate;
+		using BasicLayer<T>::id;
+
+		int in_d, in_h, in_w;
+		int out_d, out_h, out_w;
+		int kernel_h, kernel_w;
+		Padding pad;
+		BasicTensor<T> kernels;
+		///out_d x in_d
+		Eigen::MatrixX<T> pointwise;
+
+		///Patch matrix and depthwise output of the last batch, one out_h * out_w block of columns per sample
+		MatrixRX<T> cols, depth;
+
+		void CalcOutSizes();
+		///Forward pass through the given patch and depthwise matrices, shared by ForwardBatch and Infer
+		void Forward(const Eigen::MatrixX<T>& in, MatrixRX<T>& cols, MatrixRX<T>& depth, Eigen::MatrixX<T>& out) const;
+	public:
+		BasicSepConvL(T lrate, int input_h, int input_w, int output_d, int kernel_h, int kernel_w, Padding pad);
+		BasicSepConvL(const BasicSepConvL& other);
+		BasicSepConvL(std::istream& istr);
+		BasicSepConvL(BinaryReader& reader);
+
+		int InDepth() const;
+		int InHeight() const;
+		int InWidth() const;
+		int OutDepth() const;
+
+		Padding GetPadding() const;
+		BasicTensor<T> Kernels() const;
+		Eigen::MatrixX<T> Pointwise() const;
+
+		///Geometry of the depthwise stage, one kernel per input channel
+		ConvShape Shape() const;
+
+		void SetInputSize(int in_sz) override;
+		void InitParams(d_F GenFunc) override;
+		int OutSize() const override;
+
+		Eigen::MatrixX<T> ForwardBatch(const Eigen::MatrixX<T>& in) override;
+		Eigen::MatrixX<T> BackwardBatch(const Eigen::MatrixX<T>& grads) override;
+		void Infer(const Eigen::MatrixX<T>& in, Eigen::MatrixX<T>& out, LayerWorkspace<T>& ws) const override;
+
+		std::vector<Eigen::Map<Eigen::VectorX<T>>> Params() override;
+
+		std::istream& Read(std::istream& istr) override;
+		std::ostream& Write(std::ostream& ostr) const override;
+
+		void ReadBinary(BinaryReader& reader) override;
+		void WriteBinary(BinaryWriter& writer) const override;
+	};
+
+	typedef BasicSepConvL<double> SepConvL;
+	typedef BasicSepConvL<float> SepConvLf;
+}
@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "tensor.h"
+
+namespace NNet {
+	template <typename T> BasicTensor<T>::BasicTensor() : d(0), h(0), w(0) {}
+	template <typename T> BasicTensor<T>::BasicTensor(int d, int h, int w) : d(d), h(h), w(w), data(d * h * w) {}
+	template <typename T> BasicTensor<T>::BasicTensor(const Eigen::VectorX<T>& flat, int d, int h, int w) : d(d), h(h), w(w), data(flat) {
+		if (flat.size() != d * h * w) throw Exception("Tensor::Tensor: given vector doesn't match given dimensions!");
+	}
+
+	template <typename T> int BasicTensor<T>::Depth() const { return d; }
+	template <typename T> int BasicTensor<T>::Height() const { return h; }
+	template <typename T> int BasicTensor<T>::Width() const { return w; }
+
+	template <typename T> void BasicTensor<T>::SetZero() { data.setZero(); }
+
+	template <typename T> T* BasicTensor<T>::Data() { return data.data(); }
+	template <typename T> const T* BasicTensor<T>::Data() const { return data.data(); }
+
+	template <typename T> const Eigen::VectorX<T>& BasicTensor<T>::Flat() const { return data; }
+
+	template <typename T> Eigen::Map<MatrixRX<T>> BasicTensor<T>::operator[](int c) { return TensorView<T>(*this)[c]; }
+	template <typename T> Eigen::Map<const MatrixRX<T>> BasicTensor<T>::operator[](int c) const { return TensorView<const T>(*this)[c]; }
+
+	template <typename T> BasicTensor<T>::operator TensorView<T>() { return TensorView<T>(data.data(), d, h, w); }
+	template <typename T> BasicTensor<T>::operator TensorView<const T>() const { return TensorView<const T>(data.data(), d, h, w); }
+
+	template class BasicTensor<float>;
+	template class BasicTensor<double>;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <type_traits>
+#include <Eigen/Dense>
+#include "errors.h"
+
+namespace NNet {
+	template <typename T> using MatrixRX = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+	typedef MatrixRX<double> MatrixRXd;
+	typedef MatrixRX<float> MatrixRXf;
+
+	///Non-owning depth x height x width view over contiguous memory (e.g. one column of a batch)
+	///channels are stored one after another, each in row-major order, which is the layout ThreeDToVec produces
+	template <typename T> class TensorView {
+	private:
+		T* ptr;
+		int d, h, w;
+	public:
+		typedef MatrixRX<std::remove_const_t<T>> Matrix;
+		typedef std::conditional_t<std::is_const<T>::value, Eigen::Map<const Matrix>, Eigen::Map<Matrix>> ChannelMap;
+
+		TensorView(T* ptr, int d, int h, int w) : ptr(ptr), d(d), h(h), w(w) {}
+
+		int Depth() const { return d; }
+		int Height() const { return h; }
+		int Width() const { return w; }
+
+		T* Data() const { return ptr; }
+
+		///Zero-copy view of channel c
+		ChannelMap operator[](int c) const { return ChannelMap(ptr + (std::ptrdiff_t)c * h * w, h, w); }
+	};
+
+	typedef TensorView<double> TensorMap;
+	typedef TensorView<const double> ConstTensorMap;
+
+	///Contiguous depth x height x width tensor with the same layout as TensorView
+	template <typename T> class BasicTensor {
+	private:
+		int d, h, w;
+		Eigen::VectorX<T> data;
+	public:
+		BasicTensor();
+		BasicTensor(int d, int h, int w);
+		BasicTensor(const Eigen::VectorX<T>& flat, int d, int h, int w);
+
+		int Depth() const;
+		int Height() const;
+		int Width() const;
+
+		void SetZero();
+
+		T* Data();
+		const T* Data() const;
+
+		///All elements as one vector, ready to be fed to a Layer
+		const Eigen::VectorX<T>& Flat() const;
+
+		Eigen::Map<MatrixRX<T>> operator[](int c);
+		Eigen::Map<const MatrixRX<T>> operator[](int c) const;
+
+		operator TensorView<T>();
+		operator TensorView<const T>() const;
+	};
+
+	typedef BasicTensor<double> Tensor;
+	typedef BasicTensor<float> Tensorf;
+}
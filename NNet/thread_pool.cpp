@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace NNet {
+	ThreadPool::ThreadPool(int size) : job(nullptr), tasks(0), next(0), running(0), generation(0), stop(false) {
+		if (size <= 0) size = std::max(1u, std::thread::hardware_concurrency());
+		for (int i = 1; i < size; i++) threads.emplace_back(&ThreadPool::Work, this);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stop = true;
+		}
+		start_cv.notify_all();
+		for (auto& thread : threads) thread.join();
+	}
+
+	int ThreadPool::Size() const { return threads.size() + 1; }
+
+	void ThreadPool::RunTasks() {
+		for (int i = next++; i < tasks; i = next++) {
+			try { (*job)(i); }
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mtx);
+				if (!error) error = std::current_exception();
+			}
+		}
+	}
+
+	void ThreadPool::Work() {
+		unsigned long long seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				start_cv.wait(lock, [&] { return stop || generation != seen; });
+				if (stop) return;
+				seen = generation;
+			}
+
+			RunTasks();
+
+			std::lock_guard<std::mutex> lock(mtx);
+			if (!--running) done_cv.notify_all();
+		}
+	}
+
+	void ThreadPool::Run(int tasks_, const std::function<void(int)>& func) {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			job = &func;
+			tasks = tasks_;
+			next = 0;
+			running = threads.size();
+			error = nullptr;
+			generation++;
+		}
+		start_cv.notify_all();
+
+		RunTasks();
+
+		std::unique_lock<std::mutex> lock(mtx);
+		done_cv.wait(lock, [this] { return !running; });
+		if (error) std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NNet {
+	///Fixed set of threads running index-parallel jobs
+	///the thread calling Run works on the job as well, so a pool of size 1 runs everything inline
+	class ThreadPool {
+	private:
+		std::vector<std::thread> threads;
+		std::mutex mtx;
+		std::condition_variable start_cv, done_cv;
+
+		const std::function<void(int)>* job;
+		int tasks;
+		std::atomic<int> next;
+		///Helper threads still working on the current job
+		int running;
+		unsigned long long generation;
+		bool stop;
+		std::exception_ptr error;
+
+		void Work();
+		void RunTasks();
+	public:
+		///size counts the calling thread, 0 takes the number of hardware threads
+		ThreadPool(int size = 0);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool();
+
+		int Size() const;
+
+		///Calls func(0) ... func(tasks - 1) spread over all threads and returns when every call finished
+		///the first exception thrown by a call is rethrown here
+		void Run(int tasks, const std::function<void(int)>& func);
+	};
+}
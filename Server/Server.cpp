@@ -0,0 +1,304 @@
+// Server.cpp : Local inference server for NNet models over a Unix domain socket, the wire format is described in protocol.h
+//
+// Server serve <model> <socket> [--float] [--workers N] [--max-batch N] [--max-delay-ms X] [--watch-ms N] [--tuning-file PATH]
+// Server bench <socket> [--connections N] [--requests N] [--double]
+//
+
+#include "protocol.h"
+#include "../NNet/request_batcher.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <thread>
+
+#ifdef _WIN32
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
+
+using namespace NNet;
+
+static std::atomic<bool> stop_requested{ false };
+
+static void OnSignal(int) { stop_requested = true; }
+
+struct ServerOptions {
+	BatcherOptions batcher;
+	///How often the model file is checked for changes, in milliseconds
+	int watch_ms = 1000;
+	///Conv tuning results are read from and appended to this file, so restarts and hot reloads don't benchmark known shapes again
+	std::string tuning_file;
+};
+
+///A loaded model and the batcher serving it
+///requests keep a shared_ptr to the model they started on, so a replaced model lives until its last request is answered
+template <typename T> struct Model {
+	std::filesystem::file_time_type stamp;
+	std::unique_ptr<BasicNeuralNet<T>> net;
+	///Declared after net, so it is destroyed first and answers its queued requests while net still exists
+	std::unique_ptr<BasicRequestBatcher<T>> batcher;
+
+	Model(const std::string& path, const BatcherOptions& options) : stamp(std::filesystem::last_write_time(path)) {
+		net = std::make_unique<BasicNeuralNet<T>>(path);
+		// conv layers are tuned here rather than on the first batch, a reloaded model is tuned while the previous one still serves
+		net->Autotune();
+		batcher = std::make_unique<BasicRequestBatcher<T>>(*net, options);
+	}
+};
+
+template <typename T> class InferenceServer {
+private:
+	struct Connection {
+		Socket sock;
+		std::thread thread;
+		std::atomic<bool> done{ false };
+	};
+
+	std::string model_path, socket_path;
+	ServerOptions options;
+
+	///Read and replaced through std::atomic_load and std::atomic_store only
+	std::shared_ptr<Model<T>> model;
+
+	void Handle(Connection& conn);
+	void Watch();
+public:
+	InferenceServer(const std::string& model_path, const std::string& socket_path, const ServerOptions& options) :
+		model_path(model_path), socket_path(socket_path), options(options)
+	{
+		model = std::make_shared<Model<T>>(model_path, options.batcher);
+	}
+
+	int Run();
+};
+
+template <typename V, typename T> static void AppendValues(std::vector<char>& buf, const Eigen::VectorX<T>& values) {
+	size_t pos = buf.size();
+	buf.resize(pos + values.size() * sizeof(V));
+	Eigen::Map<Eigen::VectorX<V>>(reinterpret_cast<V*>(buf.data() + pos), values.size()) = values.template cast<V>();
+}
+
+static bool SendFrame(Socket sock, std::vector<char>& buf, uint32_t type, uint32_t size, uint32_t status) {
+	FrameHeader header{ RESPONSE_MAGIC, type, size, status };
+	memcpy(buf.data(), &header, sizeof(header));
+	return SendAll(sock, buf.data(), buf.size());
+}
+
+static bool SendError(Socket sock, std::vector<char>& buf, const std::string& message) {
+	buf.resize(sizeof(FrameHeader));
+	buf.insert(buf.end(), message.begin(), message.end());
+	return SendFrame(sock, buf, DATA_NONE, (uint32_t)message.size(), STATUS_ERROR);
+}
+
+template <typename T> void InferenceServer<T>::Handle(Connection& conn) {
+	Socket sock = conn.sock;
+	FrameHeader header;
+	// staging buffer for payloads that can't be received in place, the reply is assembled in out
+	std::vector<char> raw, out;
+
+	while (RecvAll(sock, &header, sizeof(header))) {
+		size_t bytes = PayloadBytes(header);
+		// a bad header means the stream is out of sync, nothing after it can be trusted
+		if (header.magic != REQUEST_MAGIC || bytes > MAX_FRAME_BYTES) break;
+		if (header.type != DATA_NONE && header.type != DATA_FLOAT && header.type != DATA_DOUBLE) break;
+
+		std::shared_ptr<Model<T>> current = std::atomic_load(&model);
+		int in_sz = current->net->InSize(), out_sz = current->net->OutSize();
+		out.resize(sizeof(FrameHeader));
+
+		if (header.code != OP_INFER || header.type == DATA_NONE) {
+			raw.resize(bytes);
+			if (!RecvAll(sock, raw.data(), bytes)) break;
+
+			if (header.code != OP_INFO) {
+				if (!SendError(sock, out, "Unknown request!")) break;
+				continue;
+			}
+			uint32_t sizes[2] = { (uint32_t)in_sz, (uint32_t)out_sz };
+			out.insert(out.end(), (char*)sizes, (char*)sizes + sizeof(sizes));
+			if (!SendFrame(sock, out, DATA_NONE, sizeof(sizes), STATUS_OK)) break;
+			continue;
+		}
+
+		// frames of the served scalar type are received straight into the vector that is handed to the batcher
+		Eigen::VectorX<T> in(header.size);
+		if (header.type == sizeof(T)) {
+			if (!RecvAll(sock, in.data(), bytes)) break;
+		}
+		else {
+			raw.resize(bytes);
+			if (!RecvAll(sock, raw.data(), bytes)) break;
+			if (header.type == DATA_FLOAT) in = Eigen::Map<Eigen::VectorXf>((float*)raw.data(), header.size).cast<T>();
+			else in = Eigen::Map<Eigen::VectorXd>((double*)raw.data(), header.size).cast<T>();
+		}
+
+		if ((int)header.size != in_sz) {
+			if (!SendError(sock, out, "Input has " + std::to_string(header.size) + " values, the model expects " + std::to_string(in_sz) + "!")) break;
+			continue;
+		}
+
+		Eigen::VectorX<T> res;
+		try { res = current->batcher->Submit(std::move(in)).get(); }
+		catch (const std::exception& e) {
+			if (!SendError(sock, out, std::string("Inference failed: ") + e.what())) break;
+			continue;
+		}
+		current.reset();
+
+		if (header.type == DATA_FLOAT) AppendValues<float>(out, res);
+		else AppendValues<double>(out, res);
+		if (!SendFrame(sock, out, header.type, (uint32_t)res.size(), STATUS_OK)) break;
+	}
+
+	conn.done = true;
+}
+
+template <typename T> void InferenceServer<T>::Watch() {
+	std::filesystem::file_time_type failed;
+	while (!stop_requested) {
+		for (int t = 0; t < options.watch_ms && !stop_requested; t += 50) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		std::error_code err;
+		auto stamp = std::filesystem::last_write_time(model_path, err);
+		std::shared_ptr<Model<T>> current = std::atomic_load(&model);
+		if (err || stamp == current->stamp || stamp == failed) continue;
+
+		// the new model is loaded next to the old one, which keeps serving until the swap
+		// NeuralNet::Save replaces the file atomically, so a complete model is read as long as it was written that way
+		std::shared_ptr<Model<T>> next;
+		try { next = std::make_shared<Model<T>>(model_path, options.batcher); }
+		catch (const std::exception& e) {
+			std::cerr << "Cannot load the changed model, still serving the previous one: " << e.what() << '\n';
+			failed = stamp;
+			continue;
+		}
+
+		std::atomic_store(&model, next);
+		std::cout << "Reloaded " << model_path << ", the previous model served:\n" << current->batcher->Stats();
+	}
+}
+
+template <typename T> int InferenceServer<T>::Run() {
+	if (socket_path.size() >= sizeof(sockaddr_un::sun_path)) { std::cerr << "Socket path is too long\n"; return 1; }
+
+	Socket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET) { std::cerr << "Cannot create a socket\n"; return 1; }
+
+	// a socket file left behind by a previous run would make bind fail, anything else at the path is left alone
+	std::error_code err;
+	if (std::filesystem::is_socket(socket_path, err)) std::filesystem::remove(socket_path, err);
+	sockaddr_un addr = SocketAddress(socket_path);
+	if (bind(listener, (sockaddr*)&addr, sizeof(addr)) || listen(listener, 128)) {
+		std::cerr << "Cannot listen on " << socket_path << '\n';
+		CloseSocket(listener);
+		return 1;
+	}
+
+	std::cout << "Serving " << model_path << " (" << model->net->InSize() << " -> " << model->net->OutSize() << ") on " << socket_path << '\n';
+
+	std::thread watcher(&InferenceServer::Watch, this);
+	std::list<Connection> connections;
+
+	while (!stop_requested) {
+		pollfd pfd{ listener, POLLIN, 0 };
+		int ready = poll(&pfd, 1, 200);
+
+		for (auto it = connections.begin(); it != connections.end(); ) {
+			if (!it->done) { ++it; continue; }
+			it->thread.join();
+			CloseSocket(it->sock);
+			it = connections.erase(it);
+		}
+		if (ready <= 0) continue;
+
+		Socket sock = accept(listener, nullptr, nullptr);
+		if (sock == INVALID_SOCKET) continue;
+
+		Connection& conn = connections.emplace_back();
+		conn.sock = sock;
+		conn.thread = std::thread(&InferenceServer::Handle, this, std::ref(conn));
+	}
+
+	// requests that are already queued are still answered, shutting the sockets down only wakes up idle connections
+	for (auto& conn : connections) {
+#ifdef _WIN32
+		shutdown(conn.sock, SD_RECEIVE);
+#else
+		shutdown(conn.sock, SHUT_RD);
+#endif
+	}
+	for (auto& conn : connections) {
+		conn.thread.join();
+		CloseSocket(conn.sock);
+	}
+	watcher.join();
+
+	CloseSocket(listener);
+	std::filesystem::remove(socket_path, err);
+
+	std::cout << "Stopped, the current model served:\n" << std::atomic_load(&model)->batcher->Stats();
+	return 0;
+}
+
+template <typename T> static int RunServer(const std::string& model_path, const std::string& socket_path, const ServerOptions& options) {
+	std::unique_ptr<InferenceServer<T>> server;
+	try { server = std::make_unique<InferenceServer<T>>(model_path, socket_path, options); }
+	catch (const std::exception& e) {
+		std::cerr << "Cannot load " << model_path << ": " << e.what() << '\n';
+		return 1;
+	}
+	return server->Run();
+}
+
+int Serve(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: Server serve <model> <socket> [--float] [--workers N] [--max-batch N] [--max-delay-ms X] [--watch-ms N] [--tuning-file PATH]\n";
+		return 1;
+	}
+
+	ServerOptions options;
+	bool single = false;
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--float") single = true;
+		else if (arg == "--workers" && has_value) options.batcher.workers = std::stoi(argv[++i]);
+		else if (arg == "--max-batch" && has_value) options.batcher.max_batch = std::stoi(argv[++i]);
+		else if (arg == "--max-delay-ms" && has_value) options.batcher.max_delay = std::stod(argv[++i]) / 1e3;
+		else if (arg == "--watch-ms" && has_value) options.watch_ms = std::stoi(argv[++i]);
+		else if (arg == "--tuning-file" && has_value) options.tuning_file = argv[++i];
+		else { std::cerr << "Unknown option " << arg << '\n'; return 1; }
+	}
+
+	// set before the first Model is built, its Autotune already reads and writes the file
+	if (!options.tuning_file.empty()) SetConvTuningFile(options.tuning_file);
+
+	std::signal(SIGINT, OnSignal);
+	std::signal(SIGTERM, OnSignal);
+
+	if (single) return RunServer<float>(argv[0], argv[1], options);
+	return RunServer<double>(argv[0], argv[1], options);
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#else
+	// writes to a client that went away have to fail instead of killing the server
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+	std::string mode = argc > 1 ? argv[1] : "";
+	if (mode == "serve") return Serve(argc - 2, argv + 2);
+	if (mode == "bench") return LoadGenerator(argc - 2, argv + 2);
+
+	std::cerr << "Usage: Server serve <model> <socket> [options] | Server bench <socket> [options]\n";
+	return 1;
+}
@@ -0,0 +1,133 @@
+// Load generator for the inference server: every connection sends its next request as soon as the previous one was answered
+// and the latency of each request is recorded, so the result shows throughput and latency at that concurrency
+
+#include "protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+static Socket Connect(const std::string& path) {
+	Socket sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock == INVALID_SOCKET) return sock;
+
+	sockaddr_un addr = SocketAddress(path);
+	if (connect(sock, (sockaddr*)&addr, sizeof(addr))) {
+		CloseSocket(sock);
+		return INVALID_SOCKET;
+	}
+	return sock;
+}
+
+///Reads one response into payload, prints the message of error responses
+static bool ReadResponse(Socket sock, FrameHeader& header, std::vector<char>& payload) {
+	if (!RecvAll(sock, &header, sizeof(header)) || header.magic != RESPONSE_MAGIC || PayloadBytes(header) > MAX_FRAME_BYTES) return false;
+
+	payload.resize(PayloadBytes(header));
+	if (!RecvAll(sock, payload.data(), payload.size())) return false;
+
+	if (header.code != STATUS_OK) std::cerr << "Server error: " << std::string(payload.begin(), payload.end()) << '\n';
+	return true;
+}
+
+///Sends requests of value type V on one connection, appends the latency of each answered one in seconds
+template <typename V> static void RunConnection(const std::string& path, int in_sz, int requests, unsigned seed, std::vector<double>& latencies, int& errors) {
+	Socket sock = Connect(path);
+	if (sock == INVALID_SOCKET) { errors += requests; return; }
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<V> dist(0, 1);
+
+	// the frame is built once per connection, only the values change between requests
+	std::vector<char> request(sizeof(FrameHeader) + in_sz * sizeof(V)), payload;
+	FrameHeader header{ REQUEST_MAGIC, sizeof(V), (uint32_t)in_sz, OP_INFER };
+	memcpy(request.data(), &header, sizeof(header));
+	V* values = reinterpret_cast<V*>(request.data() + sizeof(FrameHeader));
+
+	for (int r = 0; r < requests; r++) {
+		for (int i = 0; i < in_sz; i++) values[i] = dist(gen);
+
+		auto start = std::chrono::steady_clock::now();
+		if (!SendAll(sock, request.data(), request.size()) || !ReadResponse(sock, header, payload)) {
+			errors += requests - r;
+			break;
+		}
+		if (header.code != STATUS_OK) { errors++; continue; }
+		latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	CloseSocket(sock);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0.;
+	return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+int LoadGenerator(int argc, char** argv) {
+	if (argc < 1) {
+		std::cerr << "Usage: Server bench <socket> [--connections N] [--requests N] [--double]\n";
+		return 1;
+	}
+
+	std::string path = argv[0];
+	int connections = 8, requests = 1000;
+	bool doubles = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--connections" && has_value) connections = std::stoi(argv[++i]);
+		else if (arg == "--requests" && has_value) requests = std::stoi(argv[++i]);
+		else if (arg == "--double") doubles = true;
+		else { std::cerr << "Unknown option " << arg << '\n'; return 1; }
+	}
+
+	// the input size comes from the server, so the generator works with any model
+	Socket sock = Connect(path);
+	if (sock == INVALID_SOCKET) { std::cerr << "Cannot connect to " << path << '\n'; return 1; }
+	FrameHeader header{ REQUEST_MAGIC, DATA_NONE, 0, OP_INFO };
+	std::vector<char> payload;
+	bool ok = SendAll(sock, &header, sizeof(header)) && ReadResponse(sock, header, payload) && header.code == STATUS_OK && payload.size() == 2 * sizeof(uint32_t);
+	CloseSocket(sock);
+	if (!ok) { std::cerr << "Cannot query the model size\n"; return 1; }
+
+	uint32_t sizes[2];
+	memcpy(sizes, payload.data(), sizeof(sizes));
+	std::cout << "Model " << sizes[0] << " -> " << sizes[1] << ", " << connections << " connections x " << requests << " requests\n";
+
+	std::vector<std::vector<double>> latencies(connections);
+	std::vector<int> errors(connections, 0);
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int c = 0; c < connections; c++) {
+		latencies[c].reserve(requests);
+		if (doubles) threads.emplace_back(RunConnection<double>, path, (int)sizes[0], requests, c + 1, std::ref(latencies[c]), std::ref(errors[c]));
+		else threads.emplace_back(RunConnection<float>, path, (int)sizes[0], requests, c + 1, std::ref(latencies[c]), std::ref(errors[c]));
+	}
+	for (auto& t : threads) t.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<double> all;
+	int failed = 0;
+	for (int c = 0; c < connections; c++) {
+		all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+		failed += errors[c];
+	}
+	std::sort(all.begin(), all.end());
+
+	double mean = 0.;
+	for (double l : all) mean += l;
+	if (!all.empty()) mean /= all.size();
+
+	std::cout << "answered: " << all.size() << ", failed: " << failed << ", " << seconds << " s\n"
+		<< "throughput: " << all.size() / seconds << " requests/s\n"
+		<< "latency (ms): mean " << mean * 1e3 << ", p50 " << Percentile(all, 0.5) * 1e3 << ", p90 " << Percentile(all, 0.9) * 1e3
+		<< ", p99 " << Percentile(all, 0.99) * 1e3 << ", max " << (all.empty() ? 0. : all.back() * 1e3) << '\n';
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// Wire format of the inference server, shared by the server and the load generator
+// every message is a FrameHeader followed by size values of the given type, all in native byte order (local sockets only)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET Socket;
+inline void CloseSocket(Socket s) { closesocket(s); }
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int Socket;
+const Socket INVALID_SOCKET = -1;
+inline void CloseSocket(Socket s) { close(s); }
+#endif
+
+const uint32_t REQUEST_MAGIC = 0x51524E4E;  // "NNRQ"
+const uint32_t RESPONSE_MAGIC = 0x53524E4E; // "NNRS"
+
+///Type of the values after the header, the value is the size of one
+///DATA_NONE frames carry size raw bytes
+enum DataType : uint32_t { DATA_NONE = 0, DATA_FLOAT = 4, DATA_DOUBLE = 8 };
+
+///Requests: OP_INFER carries one input vector and is answered with the output vector in the same type,
+///OP_INFO has no values and is answered with the input and output size of the model as two uint32 (8 bytes of DATA_NONE)
+enum OpCode : uint32_t { OP_INFER = 0, OP_INFO = 1 };
+///Responses: STATUS_ERROR frames carry an error message as DATA_NONE
+enum Status : uint32_t { STATUS_OK = 0, STATUS_ERROR = 1 };
+
+struct FrameHeader {
+	uint32_t magic;
+	uint32_t type;
+	///Number of values that follow
+	uint32_t size;
+	///OpCode in requests, Status in responses
+	uint32_t code;
+};
+
+///Largest payload accepted in one frame
+const size_t MAX_FRAME_BYTES = 64 << 20;
+
+inline size_t PayloadBytes(const FrameHeader& header) {
+	return header.type == DATA_NONE ? header.size : (size_t)header.size * header.type;
+}
+
+///Blocking loops over recv and send, false once the peer closed the connection or on errors
+inline bool RecvAll(Socket s, void* data, size_t size) {
+	char* ptr = static_cast<char*>(data);
+	while (size) {
+		auto n = recv(s, ptr, (int)std::min(size, (size_t)1 << 30), 0);
+		if (n <= 0) return false;
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+inline bool SendAll(Socket s, const void* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+	const char* ptr = static_cast<const char*>(data);
+	while (size) {
+		auto n = send(s, ptr, (int)std::min(size, (size_t)1 << 30), flags);
+		if (n <= 0) return false;
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline sockaddr_un SocketAddress(const std::string& path) {
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+	return addr;
+}
+
+int Serve(int argc, char** argv);
+int LoadGenerator(int argc, char** argv);
@@ -26,6 +26,8 @@ vector<Eigen::MatrixXd> in{ Eigen::MatrixXd{5, 5} };
 vector<double> out = { 0, 1 };
 
 int main() {
+    SetConvTuningFile(NN_DIR + "conv_tuning.txt");
+
     in.front() << 
         0.1, 0.2, 0.1, 0.2, 0.1,
         0.2, 0.1, 0.2, 0.1, 0.2,
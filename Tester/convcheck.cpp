@@ -0,0 +1,110 @@
+#define EXCLUDE
+#ifndef EXCLUDE
+
+// Checks every convolution engine against a plain loop over the definition of ConvShape,
+// including SAME shapes whose kernels are larger than the input (these used to throw in the FFT engine)
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include "../NNet/neural_net.h"
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace NNet;
+
+// output channel i * kernel_d + j at (p, q) is the full convolution of input channel i with kernel j at (p + off_h, q + off_w)
+Eigen::MatrixXd ReferenceForward(const ConvShape& s, const Eigen::MatrixXd& in, const Tensor& kernels) {
+    Eigen::MatrixXd out = Eigen::MatrixXd::Zero(s.in_d * s.kernel_d * s.out_h * s.out_w, in.cols());
+    for (int c = 0; c < in.cols(); c++) {
+        TensorView<const double> src(in.col(c).data(), s.in_d, s.in_h, s.in_w);
+        TensorView<double> dst(out.col(c).data(), s.in_d * s.kernel_d, s.out_h, s.out_w);
+        for (int i = 0; i < s.in_d; i++) {
+            for (int j = 0; j < s.kernel_d; j++) {
+                for (int p = 0; p < s.out_h; p++) {
+                    for (int q = 0; q < s.out_w; q++) {
+                        double sum = 0;
+                        for (int a = 0; a < s.kernel_h; a++) {
+                            for (int b = 0; b < s.kernel_w; b++) {
+                                int x = p + s.off_h - a, y = q + s.off_w - b;
+                                if (x >= 0 && x < s.in_h && y >= 0 && y < s.in_w) sum += src[i](x, y) * kernels[j](a, b);
+                            }
+                        }
+                        dst[i * s.kernel_d + j](p, q) = sum;
+                    }
+                }
+            }
+        }
+    }
+    return out;
+}
+
+// forward against the reference, backward against DirectConv, returns the number of failures
+int CheckShape(int in_d, int in_h, int in_w, int kernel_d, int kernel_h, int kernel_w, Padding pad) {
+    int out_h = pad == SAME ? in_h : in_h - kernel_h + 1, out_w = pad == SAME ? in_w : in_w - kernel_w + 1;
+    ConvShape shape = MakeConvShape(in_d, in_h, in_w, kernel_d, kernel_h, kernel_w, out_h, out_w, pad);
+
+    Tensor kernels(kernel_d, kernel_h, kernel_w);
+    Eigen::Map<Eigen::VectorXd>(kernels.Data(), kernel_d * kernel_h * kernel_w).setRandom();
+    Eigen::MatrixXd in = Eigen::MatrixXd::Random(in_d * in_h * in_w, 3);
+    Eigen::MatrixXd grads = Eigen::MatrixXd::Random(in_d * kernel_d * out_h * out_w, 3);
+    Eigen::MatrixXd expected = ReferenceForward(shape, in, kernels);
+
+    Eigen::MatrixXd ref_in_grads = Eigen::MatrixXd::Zero(in.rows(), in.cols());
+    Tensor ref_kernel_grads(kernel_d, kernel_h, kernel_w);
+    ref_kernel_grads.SetZero();
+    unique_ptr<ConvEngine<double>> direct{ MakeConvEngine<double>(CONV_DIRECT, shape) };
+    direct->Backward(grads, in, kernels, ref_in_grads, ref_kernel_grads);
+
+    int failures = 0;
+    for (ConvAlgo algo : { CONV_AUTO, CONV_FFT, CONV_DIRECT, CONV_IM2COL, CONV_WINOGRAD }) {
+        if (algo == CONV_WINOGRAD && (kernel_h != 3 || kernel_w != 3)) continue;
+
+        double forward_err, backward_err;
+        try {
+            unique_ptr<ConvEngine<double>> engine{ MakeConvEngine<double>(algo, shape) };
+            Eigen::MatrixXd out(expected.rows(), expected.cols());
+            engine->Forward(in, kernels, out);
+            forward_err = (out - expected).norm();
+
+            Eigen::MatrixXd in_grads = Eigen::MatrixXd::Zero(in.rows(), in.cols());
+            Tensor kernel_grads(kernel_d, kernel_h, kernel_w);
+            kernel_grads.SetZero();
+            engine->Backward(grads, in, kernels, in_grads, kernel_grads);
+            backward_err = (in_grads - ref_in_grads).norm() + (kernel_grads.Flat() - ref_kernel_grads.Flat()).norm();
+        }
+        catch (Exception&) {
+            forward_err = backward_err = INFINITY;
+        }
+
+        if (!(forward_err < 1e-9) || !(backward_err < 1e-9)) {
+            cout << "algo " << algo << ", input " << in_d << 'x' << in_h << 'x' << in_w << ", kernels " << kernel_d << 'x' << kernel_h << 'x' << kernel_w
+                << (pad == SAME ? " SAME" : " VALID") << ": forward error " << forward_err << ", backward error " << backward_err << '\n';
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    for (int h = 1; h <= 6; h++) {
+        for (int w = 1; w <= 6; w++) {
+            for (int k : { 1, 2, 3, 5, 7 }) {
+                failures += CheckShape(2, h, w, 2, k, k, SAME);
+                if (k <= h && k <= w) failures += CheckShape(2, h, w, 2, k, k, VALID);
+            }
+            failures += CheckShape(1, h, w, 3, 3, 5, SAME);
+        }
+    }
+
+    // kernels larger than the input with the default CONV_AUTO, tuning used to abort while the net was built
+    NeuralNet n(16, { new ConvL(0.1, 16, 1, 2, 3, 3, SAME), new DenseL(0.1, 2) }, SqLoss, SqLossDeriv);
+    n.Autotune();
+    n.QueryBatch(Eigen::MatrixXd::Random(16, 4));
+
+    cout << (failures ? "FAILED: " : "passed, ") << failures << " failing engine/shape pairs\n";
+    return failures ? 1 : 0;
+}
+
+#endif
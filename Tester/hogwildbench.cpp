@@ -0,0 +1,53 @@
+#define EXCLUDE
+#ifndef EXCLUDE
+
+// Thread scaling of HogwildTrainer on the MNIST-sized 784-100-10 dense net with small batches
+// every thread count trains the same number of samples per thread, ideal scaling keeps samples/s proportional to the threads
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "../NNet/neural_net.h"
+#include "../NNet/hogwild_trainer.h"
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace NNet;
+
+const int SAMPLES_PER_THREAD = 20000;
+
+int main() {
+    int max_threads = max(1u, thread::hardware_concurrency());
+
+    for (int batch : { 1, 8, 64 }) {
+        // MNIST inputs are mostly zero, which leaves whole columns of the first layer unchanged by a step
+        Eigen::MatrixXd in = Eigen::MatrixXd::Random(784, batch).cwiseMax(0), target = Eigen::MatrixXd::Random(10, batch);
+
+        NeuralNet plain(784, { new DenseL(0.1, 100), new DenseL(0.1, 10) }, SqLoss, SqLossDeriv);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < SAMPLES_PER_THREAD / batch; i++) plain.FitBatch(in, target);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "batch " << batch << ", plain FitBatch: " << SAMPLES_PER_THREAD / seconds << " samples/s\n";
+
+        double single = 0;
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            NeuralNet net(784, { new DenseL(0.1, 100), new DenseL(0.1, 10) }, SqLoss, SqLossDeriv);
+            HogwildTrainer trainer(net, threads);
+
+            vector<int> left(threads, SAMPLES_PER_THREAD / batch);
+            HogwildReport report = trainer.Train([&](int t, Eigen::MatrixXd& i, Eigen::MatrixXd& tg) {
+                if (!left[t]--) return false;
+                i = in;
+                tg = target;
+                return true;
+            });
+
+            if (threads == 1) single = report.samples_per_second;
+            cout << "batch " << batch << ", " << threads << " threads: " << report.samples_per_second << " samples/s, speedup "
+                << report.samples_per_second / single << '\n';
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include <filesystem>
 
 #include "../NNet/neural_net.h"
+#include "../NNet/packed_dataset.h"
+#include "../NNet/data_loader.h"
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <Eigen/Dense>
@@ -15,6 +17,7 @@ using namespace Eigen;
 
 const string DATASET = R"(C:\Users\lukad\Desktop\math_symbols\)";
 const string NN_DIR = R"(C:\Users\lukad\Desktop\math_symbols\nn_models\)";
+const string PACKED = R"(C:\Users\lukad\Desktop\math_symbols\packed\symbols)";
 const int TRESHOLD = 230;
 
 std::vector<std::string> GetFilenames(const string& folder)
@@ -67,42 +70,45 @@ Eigen::MatrixXd cvMat2MatrixXd(const cv::Mat& img) {
 }
 
 vector<string> decode{ "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "+", "-", "mul", "div", "=", "(", ")" };
-vector<vector<Eigen::MatrixXd>> LoadData() {
-    vector<vector<Eigen::MatrixXd>> ret;
+const int IMG_SIZE = 59;
 
-    for (int id = 0; id < decode.size(); id++) {
-        auto fnames = GetFilenames(DATASET + decode[id]);
+// decodes every image of the dataset once and packs them into shards next to PACKED
+void PackData() {
+    PackedDatasetWriter writer(PACKED, 1, IMG_SIZE, IMG_SIZE, decode);
 
-        ret.push_back(vector<Eigen::MatrixXd>{});
-        for (int i = 0; i < fnames.size(); i++) {
-            auto fname = fnames[i];
+    for (int id = 0; id < decode.size(); id++) {
+        for (auto& fname : GetFilenames(DATASET + decode[id])) {
             cv::Mat img = cv::imread(fname, cv::IMREAD_GRAYSCALE);
-
-            ret.back().push_back(cvMat2MatrixXd(img));
-            for (int i = 0; i < ret.back().back().rows(); i++) {
-                for (int j = 0; j < ret.back().back().cols(); j++) {
-                    ret.back().back()(i, j) = Scale(ret.back().back()(i, j), 0, 255, 0, 1);
-                }
+            if (img.rows != IMG_SIZE || img.cols != IMG_SIZE || !img.isContinuous()) {
+                std::cout << "Skipping " << fname << ", it is not a " << IMG_SIZE << "x" << IMG_SIZE << " image\n";
+                continue;
             }
-
-            //ret.back().back() = Treshold(ret.back().back(), 0.7);
+            writer.Add(img.ptr<uchar>(), id);
         }
     }
 
-    return ret;
+    writer.Close();
+    std::cout << "Packed " << writer.Size() << " images\n";
 }
 
-void Train(NeuralNet& net, const string& modelpath, const vector<vector<Eigen::MatrixXd>>& data, int prefix = -1, const std::vector<int> classes = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 }) {
-    vector<int> ptr(data.size());
-    vector<int> order;
-
-    for (int i : classes) {
-        int lim = (prefix > 0) ? prefix : data[i].size();
-        for (int j = 0; j < std::min(lim, (int)data[i].size()); j++) {
-            order.push_back(i);
-        }
+// samples of the given classes, the first prefix images of every class are the training set and the rest the test set
+// prefix <= 0 doesn't split, both sets are then all samples of the classes
+vector<int> Split(const PackedDataset& data, int prefix, const std::vector<int>& classes, bool train) {
+    vector<int> seen(data.Classes()), ret;
+    vector<bool> used(data.Classes());
+    for (int c : classes) used[c] = true;
+
+    for (int i = 0; i < data.Size(); i++) {
+        int c = data.Label(i);
+        if (!used[c]) continue;
+        if (prefix <= 0 || (seen[c] < prefix) == train) ret.push_back(i);
+        seen[c]++;
     }
 
+    return ret;
+}
+
+void Train(NeuralNet& net, const string& modelpath, const PackedDataset& data, int prefix = -1, const std::vector<int> classes = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 }) {
     int epochs;
     std::cout << "No. of epochs: "; cin >> epochs;
 
@@ -110,45 +116,25 @@ void Train(NeuralNet& net, const string& modelpath, const vector<vector<Eigen::M
     std::cout << "How often would you like to be informed of progress? (image number): "; cin >> step;
     std::cout << "How often would you like to save your NN? (image number): "; cin >> save_step;
 
+    // one image per update as before, shuffling and scaling happen on the loader threads
+    LoaderOptions options;
+    options.batch_size = 1;
+    options.seed = std::chrono::system_clock::now().time_since_epoch().count();
+    options.indices = Split(data, prefix, classes, true);
+    options.epochs = epochs;
+    DataLoader loader(data, options);
+
+    DataLoader::Batch batch;
     for (int ep = 1; ep <= epochs; ep++) {
         std::cout << "---------- Epoch " << ep << " ----------\n";
-        for (auto& e : ptr) e = 0;
-
-        unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-        shuffle(order.begin(), order.end(), std::default_random_engine(seed));
 
         double loss = 0;
-        for (int i = 0; i < order.size(); i++) {
-            Eigen::VectorXd tar = Eigen::VectorXd::Zero(data.size());
-            tar[order[i]] = 1;
-
-            Eigen::MatrixXd in = data[order[i]][ptr[order[i]]++];
-
-            //auto result = net.Query(ThreeDToVec(vector<Eigen::MatrixXd>{in}));
-            loss += net.Fit(ThreeDToVec(vector<Eigen::MatrixXd>{in}), tar);
+        for (int i = 0; i < loader.BatchesPerEpoch() && loader.Next(batch); i++) {
+            loss += net.FitBatch(batch.inputs, batch.targets);
 
             if ((i + 1) % step == 0) {
                 std::cout << "Passed " << i + 1 << " images, average loss is: " << loss / step << '\n';
 
-                /*if (loss / step < 0.25) {
-                    net.Universal_Lrate(0.001);
-                    net.Universal_Bias_Lrate(0.002);
-                }*/
-
-                /*std::cout << Treshold(in, 0.7) << '\n' << result << "\n\n";
-
-                int maxind = -1;
-                double maxi = -1e9;
-
-                for (int iter = 0; iter < result.size(); iter++) {
-                    if (result[iter] > maxi) {
-                        maxind = iter;
-                        maxi = result[iter];
-                    }
-                }
-
-                std::std::cout << "Last target: " << order[i] << ", net prediction: " << maxind << '\n';*/
-
                 if (isnan(loss)) {
                     std::cout << "Loss is NaN, breaking the training process...\n";
                     return;
@@ -170,37 +156,31 @@ void Train(NeuralNet& net, const string& modelpath, const vector<vector<Eigen::M
         std::cout << "Done saving\n";
     }
 }
-void Test(NeuralNet& net, const vector<vector<Eigen::MatrixXd>>& data, int train_pref = 0) {
+void Test(NeuralNet& net, const PackedDataset& data, int train_pref = 0) {
     std::cout << "Testing...\n";
 
-    int total_corr = 0, total_cnt = 0;
-    for (int id = 0; id < data.size(); id++) {
-        std::cout << "Symbol " << decode[id] << ":\n";
-
-        int digit_corr = 0;
-        for (int nes = train_pref; nes < data[id].size(); nes++) {
-            auto input = data[id][nes];
-
-            auto res = net.Query(ThreeDToVec(vector<Eigen::MatrixXd>{input}));
+    vector<int> corr(data.Classes()), cnt(data.Classes());
+    for (int i : Split(data, train_pref, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 }, false)) {
+        Eigen::VectorXd input = Eigen::Map<const Eigen::Matrix<uchar, Eigen::Dynamic, 1>>(data.Sample(i), data.InputSize()).cast<double>() / 255;
 
-            double maxi = -1e9;
-            int pred = -1;
+        Eigen::Index pred;
+        net.Query(input).maxCoeff(&pred);
 
-            for (int i = 0; i < res.size(); i++) {
-                if (res(i) > maxi) {
-                    maxi = res(i);
-                    pred = i;
-                }
-            }
+        int id = data.Label(i);
+        cnt[id]++;
+        if (pred == id) corr[id]++;
+    }
 
-            if (pred == id) digit_corr++;
-        }
+    int total_corr = 0, total_cnt = 0;
+    for (int id = 0; id < data.Classes(); id++) {
+        std::cout << "Symbol " << decode[id] << ":\n";
 
-        total_corr += digit_corr;
-        total_cnt += data[id].size() - train_pref;
+        total_corr += corr[id];
+        total_cnt += cnt[id];
 
-        std::cout << "   Local accuracy: " << digit_corr << "/" << (data[id].size() - train_pref) << ", " << (double)digit_corr / (data[id].size() - train_pref) * 100 << "%\n";
-        std::cout << "   Total accuracy until now: " << total_corr << "/" << total_cnt << ", " << (double)total_corr / total_cnt * 100 << "%\n\n";
+        // a class without test samples has no accuracy, it is reported as 0%
+        std::cout << "   Local accuracy: " << corr[id] << "/" << cnt[id] << ", " << (cnt[id] ? (double)corr[id] / cnt[id] * 100 : 0.) << "%\n";
+        std::cout << "   Total accuracy until now: " << total_corr << "/" << total_cnt << ", " << (total_cnt ? (double)total_corr / total_cnt * 100 : 0.) << "%\n\n";
     }
 }
 
@@ -240,8 +220,15 @@ NeuralNet net
 
 int main()
 {
-    std::cout << "Loading data...\n";
-    auto data = LoadData();
+    // conv shapes measured on an earlier run aren't benchmarked again
+    SetConvTuningFile(NN_DIR + "conv_tuning.txt");
+
+    // images are only decoded on the first run, later runs map the packed shards
+    if (!PackedDatasetExists(PACKED)) {
+        std::cout << "Packing data...\n";
+        PackData();
+    }
+    PackedDataset data(PACKED);
     //net.Load(NN_DIR + "model7998.txt");
 
     Train(net, NN_DIR + "nnet_test2.txt", data, 1000);
@@ -1,5 +1,9 @@
 #include <iostream>
 #include "../NNet/neural_net.h";
+#include "../NNet/checkpoint.h"
+#include "../NNet/idx_dataset.h"
+#include "../NNet/data_loader.h"
+#include "../NNet/parallel_trainer.h"
 #include <Eigen/Dense>
 
 using namespace std;
@@ -21,39 +25,6 @@ int Read4ByteInt(std::istream& stream) {
     return ret;
 }
 
-std::vector<ubyte> ReadUbyteIdx1File(std::istream& stream) {
-    for (int i = 0; i < 4; i++) stream.get();
-
-    int size = Read4ByteInt(stream);
-
-    std::vector<ubyte> ret;
-    ret.resize(size);
-    stream.read((char*)(&ret[0]), size);
-
-    return ret;
-}
-
-std::vector<Eigen::MatrixXd>
-ReadUbyteIdx3File(std::istream& stream) {
-    for (int i = 0; i < 4; i++) stream.get();
-
-    unsigned int size = Read4ByteInt(stream);
-    unsigned int rows = Read4ByteInt(stream);
-    unsigned int cols = Read4ByteInt(stream);
-
-    std::vector<ubyte> bytes{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
-
-    std::vector<Eigen::MatrixXd> ret;
-    for (int n = 0; n < size; n++) {
-        ret.push_back(Eigen::MatrixXd(rows, cols));
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) ret.back()(i, j) = NNet::Scale((double)bytes[n * rows * cols + i * cols + j], 0, 255, 0, 1);
-        }
-    }
-
-    return ret;
-}
-
 std::vector<std::vector<ubyte>>
 ReadAndFlattenUbyteIdx3File(std::istream& stream) {
     for (int i = 0; i < 4; i++) stream.get();
@@ -97,47 +68,64 @@ void Train(NeuralNet& net, const string& saveFile, const string& lossDump, const
     cout << "Loading data...\n";
     if (!loadFile.empty()) net.Load(FullPath(loadFile));
 
-    ifstream labfile(FullPath("MNIST_dataset\\train-labels.idx1-ubyte"), std::ios::binary);
-    auto labels = ReadUbyteIdx1File(labfile);
-    labfile.close();
-
-    ifstream imfile(FullPath("MNIST_dataset\\train-images.idx3-ubyte"), std::ios::binary);
-    auto images = ReadUbyteIdx3File(imfile);
-    imfile.close();
+    // pixels stay uint8 in the mapped files and are converted one batch at a time
+    IdxDataset images(FullPath("MNIST_dataset\\train-images.idx3-ubyte"), FullPath("MNIST_dataset\\train-labels.idx1-ubyte"));
 
-    int offset, how_many, step;
+    int offset, how_many, step, batch;
     cout << "Index of first image used for training (starting with 0): "; cin >> offset;
     cout << "How many images to take: "; cin >> how_many;
-    cout << "How often would you like to be informed of progress (image number): "; cin >> step;
+    cout << "Batch size: "; cin >> batch;
+    cout << "How often would you like to be informed of progress (image number, multiple of batch size): "; cin >> step;
     cout << "Training...\n";
 
-    if (offset + how_many > images.size()) {
+    if (offset + how_many > images.Size()) {
         cout << "Not enough images in the dataset. Taking the whole dataset for training...\n";
-        how_many = images.size() - offset;
+        how_many = images.Size() - offset;
     }
 
-    vector<double> losses;
-    double loss = 0;
-    for (int i = offset; i < offset + how_many; i++) {
-        VectorXd tar = VectorXd::Zero(10);
-        tar[labels[i]] = 1;
+    // snapshots are written on a background thread, so checkpoints don't stall training
+    Checkpointer checkpoint(FullPath(saveFile));
 
-        losses.push_back(net.Fit(ThreeDToVec(vector<MatrixXd>{images[i]}), tar));
-        loss += losses.back();
+    // batches are assembled on worker threads while the net trains on the previous ones
+    LoaderOptions options;
+    options.batch_size = batch;
+    options.shuffle = false;
+    options.first = offset;
+    options.count = how_many;
+    options.epochs = 1;
+    DataLoader loader(images, options);
+    // every batch is split over all cores, the update is the same as that of net.FitBatch
+    ParallelTrainer trainer(net);
 
-        if ((i + 1) % step == 0) {
-            cout << "Passed " << i + 1 << " images, average loss is: " << loss / step << '\n';
+    vector<double> losses;
+    double loss = 0;
+    // images are counted from the start of this run, batches rarely line up with step (or with offset)
+    int done = 0, since = 0;
+    DataLoader::Batch b;
+    while (loader.Next(b)) {
+        int n = b.inputs.cols();
+
+        double l = trainer.FitBatch(b.inputs, b.targets);
+        for (int k = 0; k < n; k++) losses.push_back(l);
+        loss += l * n;
+        since += n;
+
+        if ((done + n) / step > done / step) {
+            cout << "Passed " << done + n << " images, average loss is: " << loss / since << '\n';
             if (isnan(loss)) {
                 cout << "Loss is NaN, breaking the training process...\n";
                 return;
             }
 
             loss = 0;
-            net.Save(FullPath(saveFile));
+            since = 0;
+            checkpoint.Save(net);
         }
+        done += n;
     }
 
-    net.Save(FullPath(saveFile));
+    checkpoint.Save(net);
+    checkpoint.Wait();
 
     ofstream csvfile(FullPath(lossDump));
     for (int i = 1; i <= how_many; i++) {
@@ -150,18 +138,12 @@ void Train(NeuralNet& net, const string& saveFile, const string& lossDump, const
 void Test(NeuralNet& net) {
     cout << "Loading data...\n";
 
-    ifstream labfile(FullPath("MNIST_dataset\\test-labels.idx1-ubyte"), std::ios::binary);
-    auto labels = ReadUbyteIdx1File(labfile);
-    labfile.close();
-
-    ifstream imfile(FullPath("MNIST_dataset\\test-images.idx3-ubyte"), std::ios::binary);
-    auto images = ReadUbyteIdx3File(imfile);
-    imfile.close();
+    IdxDataset images(FullPath("MNIST_dataset\\test-images.idx3-ubyte"), FullPath("MNIST_dataset\\test-labels.idx1-ubyte"));
 
     int correct = 0;
     cout << "Testing...\n";
-    for (int i = 0; i < images.size(); i++) {
-        auto out = net.Query(ThreeDToVec(vector<MatrixXd>{images[i]}));
+    for (int i = 0; i < images.Size(); i++) {
+        auto out = net.Query(images.Input<double>(i));
         bool ok = 1;
 
         double maxi = -1; int ind = -1;
@@ -172,7 +154,7 @@ void Test(NeuralNet& net) {
             }
         }
 
-        if (ind == labels[i]) correct++;
+        if (ind == images.Label(i)) correct++;
 
         if ((i + 1) % 1000 == 0) {
             cout << "Passed " << i + 1 << " images, accuracy is: " << (double)correct / (i + 1) << '\n';